@@ -0,0 +1,418 @@
+#
+#  bw_engine
+#
+#  Python bindings of the native engine of the dynamic weight models of bw
+#  (Hall et al, 2011 for adults and Hall et al, 2013 for children) over the C
+#  interface of src/engine_api.h.
+#
+#  Inputs are NumPy arrays (float64 or float32, any memory order, including
+#  np.memmap of intake files) read in place through their strides and outputs
+#  are written by the engine into arrays allocated here (or .npy files mapped
+#  in memory with output=) so no trajectory is copied. The engine runs with
+#  the Global Interpreter Lock released: several Python threads may run models
+#  at the same time and each model may itself use threads.
+#
+#  Trajectories are arrays of individuals x (nsteps + 1) as the matrices of
+#  adult_weight and child_weight in R. Means of groups with bootstrap intervals
+#  and regression coefficients are estimated while the model runs (without
+#  keeping trajectories) with bootstrap_design and regression_design.
+#
+#  Authors:
+#  Dalia Camacho-García-Formentí
+#  Rodrigo Zepeda-Tello
+#
+#  License: MIT
+#  Copyright 2018 Instituto Nacional de Salud Pública de México
+#
+
+import ctypes
+import glob
+import math
+import os
+
+import numpy as np
+
+__all__ = ["adult_weight", "child_weight", "child_reference_FFMandFM", "child_reference_EI",
+           "intake_file", "bootstrap_design", "bootstrap_estimates", "regression_design",
+           "regression_estimates"]
+
+#Library
+#--------------------------------------------------------------------------------
+def _load():
+    here  = os.path.dirname(os.path.abspath(__file__))
+    found = sorted(glob.glob(os.path.join(here, "_engine*.so")) +
+                   glob.glob(os.path.join(here, "_engine*.pyd")) +
+                   glob.glob(os.path.join(here, "_engine*.dylib")))
+    if not found:
+        raise ImportError("Native engine of bw not found. Please build it with setup.py.")
+    return ctypes.CDLL(found[0])
+
+_lib = _load()
+
+_double = ctypes.POINTER(ctypes.c_double)
+_int    = ctypes.POINTER(ctypes.c_int)
+
+class _Input(ctypes.Structure):
+    _fields_ = [("values", ctypes.c_void_p), ("type", ctypes.c_int), ("nrow", ctypes.c_int),
+                ("rowstride", ctypes.c_longlong), ("colstride", ctypes.c_longlong)]
+
+class _Adult(ctypes.Structure):
+    _fields_ = [("nind", ctypes.c_int), ("bw", _double), ("ht", _double), ("age", _double),
+                ("sex", _double), ("pcarb_base", _double), ("pcarb", _double), ("EI", _double),
+                ("fat", _double), ("EIchange", _Input), ("NAchange", _Input), ("PAL", _Input)]
+
+class _Child(ctypes.Structure):
+    _fields_ = [("nind", ctypes.c_int), ("age", _double), ("sex", _double), ("bmiCat", _double),
+                ("FFM", _double), ("FM", _double), ("referenceValues", ctypes.c_int), ("EI", _Input)]
+
+class _Options(ctypes.Structure):
+    _fields_ = [("dt", ctypes.c_double), ("nsteps", ctypes.c_int), ("method", ctypes.c_char_p),
+                ("nthreads", ctypes.c_int), ("qss", ctypes.c_int), ("growth", ctypes.c_int),
+                ("correct", ctypes.c_int)]
+
+class _Bootstrap(ctypes.Structure):
+    _fields_ = [("group", _int), ("weights", _double), ("ids", _double), ("ngroups", ctypes.c_int),
+                ("replicates", ctypes.c_int), ("seed", ctypes.c_double), ("steps", _int),
+                ("ndays", ctypes.c_int), ("W", _double), ("S", _double), ("WB", _double),
+                ("SB", _double)]
+
+class _Regression(ctypes.Structure):
+    _fields_ = [("X", _double), ("weights", _double), ("p", ctypes.c_int), ("steps", _int),
+                ("ndays", ctypes.c_int), ("N", _double), ("sw", _double), ("XtWX", _double),
+                ("S4", _double), ("XtWy", _double), ("S2", _double), ("S3", _double)]
+
+_error = [ctypes.c_char_p, ctypes.c_int]
+for _name, _model in [("adult", _Adult), ("child", _Child)]:
+    getattr(_lib, "bw_%s_trajectories" % _name).argtypes = [ctypes.POINTER(_model), ctypes.POINTER(_Options),
+                                                           ctypes.POINTER(_double)] + _error
+    getattr(_lib, "bw_%s_bootstrap" % _name).argtypes    = [ctypes.POINTER(_model), ctypes.POINTER(_Options),
+                                                           ctypes.POINTER(_Bootstrap)] + _error
+    getattr(_lib, "bw_%s_regression" % _name).argtypes   = [ctypes.POINTER(_model), ctypes.POINTER(_Options),
+                                                           ctypes.POINTER(_Regression)] + _error
+_lib.bw_child_reference.argtypes    = [ctypes.POINTER(_Child), _double, _double] + _error
+_lib.bw_child_reference_EI.argtypes = [ctypes.POINTER(_Child), ctypes.c_double, ctypes.c_int, _double] + _error
+
+#Conversions (arrays passed to the engine are kept in keep until the run ends)
+#--------------------------------------------------------------------------------
+def _vector(x, n, keep, default=None):
+    if x is None:
+        if default is None:
+            return None
+        x = default
+    x = np.ascontiguousarray(np.broadcast_to(np.asarray(x, dtype=np.float64), (n,)))
+    keep.append(x)
+    return x.ctypes.data_as(_double)
+
+def _integers(x, keep):
+    x = np.ascontiguousarray(x, dtype=np.intc)
+    keep.append(x)
+    return x.ctypes.data_as(_int)
+
+def _buffer(x):
+    return None if x is None else x.ctypes.data_as(_double)
+
+def _sex(sex):
+    sex = np.atleast_1d(np.asarray(sex))
+    if not np.all(np.isin(sex, ["male", "female"])):
+        raise ValueError("Invalid sex. Please specify either 'male' of 'female'")
+    return (sex == "female").astype(np.float64)
+
+#Intake of individuals x times read in place (float64 or float32 in any order)
+def _input(x, n, name, keep, default=None, ntimes=0):
+    if x is None:
+        if default is None:
+            return _Input(None, 1, 0, 0, 0)
+        x = np.broadcast_to(np.float64(default), (n, ntimes))
+    x = np.asarray(x)
+    if x.ndim == 1 and n == 1:
+        x = x.reshape(1, -1)
+    if x.dtype not in (np.float64, np.float32):
+        x = x.astype(np.float64)
+    if x.ndim != 2 or x.shape[0] != n:
+        raise ValueError("Dimension mismatch. %s must have one row per individual." % name)
+    keep.append(x)
+    return _Input(x.ctypes.data, 1 if x.dtype == np.float64 else 2, x.shape[1],
+                  x.strides[1]//x.itemsize, x.strides[0]//x.itemsize)
+
+def _options(dt, nsteps, method, threads, qss=False, growth=0):
+    if dt <= 0 or dt > 1:
+        raise ValueError("Invalid time step dt. Please choose 0 < dt <= 1.")
+    return _Options(dt, nsteps, method.encode(), threads, int(qss), growth, 0)
+
+def _check(run, *args):
+    error = ctypes.create_string_buffer(512)
+    if run(*(args + (error, len(error)))) != 0:
+        raise ValueError(error.value.decode())
+
+#Trajectory of individuals x (nsteps + 1) written by the engine in place
+def _trajectory(output, name, n, nsteps):
+    if output is None:
+        return np.empty((n, nsteps + 1), order="F")
+    return np.lib.format.open_memmap(os.path.join(output, name + ".npy"), mode="w+",
+                                     dtype=np.float64, shape=(n, nsteps + 1), fortran_order=True)
+
+def _pointers(arrays):
+    return (_double*len(arrays))(*[_buffer(x) for x in arrays])
+
+#Intake files
+#--------------------------------------------------------------------------------
+def intake_file(path):
+    """Intake file written by intake_write in R mapped in memory.
+
+    Returns an array of individuals x times (float64 or float32) that
+    adult_weight (EIchange, NAchange, PAL) and child_weight (EI) read in place.
+    """
+    header = np.fromfile(path, dtype=np.uint8, count=32)
+    if header.size < 32 or header[:8].tobytes() != b"BWINTAKE":
+        raise ValueError("Invalid intake file %s." % path)
+    version, kind  = np.frombuffer(header[8:16].tobytes(), dtype="<u4")
+    ntimes, nind   = np.frombuffer(header[16:32].tobytes(), dtype="<u8")
+    if version != 1 or kind not in (1, 2):
+        raise ValueError("Invalid intake file %s." % path)
+    values = np.memmap(path, dtype="<f8" if kind == 1 else "<f4", mode="r", offset=32,
+                       shape=(int(ntimes), int(nind)))
+    return values.T
+
+#Designs of estimates
+#--------------------------------------------------------------------------------
+def bootstrap_design(group, days=365, replicates=1000, weights=None, ids=None, seed=2018):
+    """Groups whose mean body weight is estimated while the model runs with
+    Poisson bootstrap replicates (as bootstrap_design in R)."""
+    groups, codes = np.unique(np.asarray(group), return_inverse=True)
+    n        = codes.size
+    weights  = np.ones(n) if weights is None else np.asarray(weights, dtype=np.float64)
+    ids      = np.arange(1, n + 1, dtype=np.float64) if ids is None else np.asarray(ids, dtype=np.float64)
+    days     = np.atleast_1d(np.asarray(days, dtype=np.float64))
+    if weights.shape != (n,) or np.any(np.isnan(weights)) or np.any(weights < 0):
+        raise ValueError("Invalid weights. Please specify a non-negative weight for each individual.")
+    if (ids.shape != (n,) or np.any(ids != np.round(ids)) or np.any(ids < 0) or
+            np.unique(ids).size != n):
+        raise ValueError("Invalid ids. Please specify a different non-negative integer for each individual.")
+    if replicates < 1 or np.any(days < 0):
+        raise ValueError("Invalid replicates or days. Please choose replicates >= 1 and days >= 0.")
+    return {"type": "bootstrap", "groups": groups, "codes": codes, "weights": weights, "ids": ids,
+            "days": days, "replicates": int(replicates), "seed": float(seed)}
+
+def regression_design(X, weights=None, days=365, terms=None):
+    """Weighted least squares of body weight on the covariates X (individuals x
+    terms, e.g. with a column of ones) estimated while the model runs (as
+    regression_design in R)."""
+    X       = np.asfortranarray(X, dtype=np.float64)
+    weights = np.ones(X.shape[0]) if weights is None else np.asarray(weights, dtype=np.float64)
+    days    = np.atleast_1d(np.asarray(days, dtype=np.float64))
+    if X.ndim != 2 or np.any(np.isnan(X)):
+        raise ValueError("Covariates of regression have missing values.")
+    if weights.shape != (X.shape[0],) or np.any(np.isnan(weights)) or np.any(weights < 0):
+        raise ValueError("Invalid weights. Please specify a non-negative weight for each individual.")
+    if np.any(days < 0):
+        raise ValueError("Invalid days. Please choose days >= 0.")
+    terms = ["X%d" % (c + 1) for c in range(X.shape[1])] if terms is None else list(terms)
+    return {"type": "regression", "X": X, "weights": weights, "days": days, "terms": terms}
+
+def _estimate(run, model, options, design, n):
+    keep  = []
+    steps = np.round(design["days"]/options.dt).astype(np.intc)
+    ndays = steps.size
+    if design["type"] == "bootstrap":
+        if design["codes"].size != n:
+            raise ValueError("Dimension mismatch. Bootstrap must have one group per individual.")
+        B, G = design["replicates"], design["groups"].size
+        sums = {"Sum_Weights": np.zeros(G), "Sums": np.zeros((G, ndays), order="F"),
+                "Replicate_Weights": np.zeros((B, G), order="F"),
+                "Replicate_Sums": np.zeros((B, G, ndays), order="F")}
+        c = _Bootstrap(_integers(design["codes"], keep), _vector(design["weights"], n, keep),
+                       _vector(design["ids"], n, keep), G, B, design["seed"],
+                       _integers(steps, keep), ndays, _buffer(sums["Sum_Weights"]), _buffer(sums["Sums"]),
+                       _buffer(sums["Replicate_Weights"]), _buffer(sums["Replicate_Sums"]))
+        _check(run[0], ctypes.byref(model), ctypes.byref(options), ctypes.byref(c))
+        sums.update({"Groups": design["groups"], "Days": design["days"], "Seed": design["seed"]})
+        return "Bootstrap", sums
+    if design["type"] == "regression":
+        X = design["X"]
+        if X.shape[0] != n:
+            raise ValueError("Dimension mismatch. Regression must have one row per individual.")
+        p, npairs = X.shape[1], X.shape[1]*(X.shape[1] + 1)//2
+        sums = {"N": np.zeros(1), "Sum_Weights": np.zeros(1), "XtWX": np.zeros(npairs),
+                "S4": np.zeros((npairs, npairs)), "XtWy": np.zeros((p, ndays), order="F"),
+                "S2": np.zeros((npairs, ndays), order="F"), "S3": np.zeros((npairs*p, ndays), order="F")}
+        keep.append(X)
+        c = _Regression(_buffer(X), _vector(design["weights"], n, keep), p,
+                        _integers(steps, keep), ndays, _buffer(sums["N"]), _buffer(sums["Sum_Weights"]),
+                        _buffer(sums["XtWX"]), _buffer(sums["S4"]), _buffer(sums["XtWy"]),
+                        _buffer(sums["S2"]), _buffer(sums["S3"]))
+        _check(run[1], ctypes.byref(model), ctypes.byref(options), ctypes.byref(c))
+        sums["N"], sums["Sum_Weights"] = sums["N"][0], sums["Sum_Weights"][0]
+        sums.update({"Terms": design["terms"], "Days": design["days"]})
+        return "Regression", sums
+    raise ValueError("Invalid design. Please use bootstrap_design or regression_design.")
+
+def bootstrap_estimates(bootstrap, confidence=0.95):
+    """Means, standard errors and percentile confidence intervals of a
+    Bootstrap (as bootstrap_estimates in R). Returns a dict of arrays of
+    groups x days."""
+    if confidence > 1 or confidence <= 0:
+        raise ValueError("Invalid confidence level. Confidence must be between 0 and 1")
+    replicates = bootstrap["Replicate_Sums"]/bootstrap["Replicate_Weights"][:, :, None]
+    probs      = [(1 - confidence)/2, 1 - (1 - confidence)/2]
+    ci         = np.nanquantile(replicates, probs, axis=0)
+    return {"Days": bootstrap["Days"], "Groups": bootstrap["Groups"],
+            "Mean": bootstrap["Sums"]/bootstrap["Sum_Weights"][:, None],
+            "Std_Error": np.nanstd(replicates, axis=0, ddof=1), "Lower_CI": ci[0], "Upper_CI": ci[1]}
+
+def regression_estimates(regression):
+    """Coefficients and sandwich standard errors of a Regression (as
+    regression_estimates in R). Returns a dict of arrays of terms x days."""
+    p      = len(regression["Terms"])
+    pa, pb = np.triu_indices(p)
+    def unpack(z):
+        M = np.zeros((p, p))
+        M[pa, pb] = z
+        M[pb, pa] = z
+        return M
+    Ainv = np.linalg.inv(unpack(regression["XtWX"]))
+    S4   = regression["S4"] + regression["S4"].T - np.diag(np.diag(regression["S4"]))
+    n    = regression["N"]
+    ndays = len(regression["Days"])
+    beta  = np.empty((p, ndays))
+    se    = np.empty((p, ndays))
+    for d in range(ndays):
+        beta[:, d] = Ainv @ regression["XtWy"][:, d]
+        S3   = regression["S3"][:, d].reshape(-1, p)
+        meat = (regression["S2"][:, d] - 2*S3 @ beta[:, d] +
+                S4 @ (beta[pa, d]*beta[pb, d]*np.where(pa == pb, 1, 2)))
+        V    = n/(n - 1)*Ainv @ unpack(meat) @ Ainv
+        se[:, d] = np.sqrt(np.maximum(np.diag(V), 0))
+    return {"Days": regression["Days"], "Terms": regression["Terms"], "Estimate": beta, "Std_Error": se}
+
+#Models
+#--------------------------------------------------------------------------------
+def adult_weight(bw, ht, age, sex, EIchange=None, NAchange=None, PAL=None, pcarb_base=None,
+                 pcarb=None, EI=None, fat=None, days=365, dt=1, method="rk4", threads=1,
+                 qss=False, estimate=None, output=None):
+    """Dynamic weight change model of adults (Hall et al, 2011) as adult_weight in R.
+
+    EIchange, NAchange and PAL are individuals x ceil(days/dt) arrays (e.g.
+    from intake_file). With estimate (bootstrap_design or regression_design)
+    only the estimates are kept; otherwise the trajectories are returned as
+    individuals x (nsteps + 1) arrays, mapped to .npy files in the directory
+    output if given.
+    """
+    keep = []
+    bw   = np.atleast_1d(np.asarray(bw, dtype=np.float64))
+    n    = bw.size
+    ht   = np.atleast_1d(np.asarray(ht, dtype=np.float64))
+    if ht.shape != (n,) or np.size(age) != n or np.size(sex) != n:
+        raise ValueError("Dimension mismatch. bw, ht, age and sex must have the same length.")
+    if np.any(bw <= 0) or np.any(ht <= 0) or np.any(np.asarray(age) <= 0):
+        raise ValueError("Invalid bw, ht or age. Please choose positive values.")
+    days   = math.ceil(days)
+    ntimes = math.ceil(days/dt)
+    pcarb_base = 0.5 if pcarb_base is None else pcarb_base
+    model  = _Adult(n, _vector(bw, n, keep), _vector(ht, n, keep), _vector(age, n, keep),
+                    _vector(_sex(sex), n, keep), _vector(pcarb_base, n, keep),
+                    _vector(pcarb, n, keep, pcarb_base), _vector(EI, n, keep),
+                    _vector(fat, n, keep), _input(EIchange, n, "EIchange", keep, 0.0, ntimes),
+                    _input(NAchange, n, "NAchange", keep, 0.0, ntimes), _input(PAL, n, "PAL", keep, 1.5, ntimes))
+    nsteps = min(ntimes, model.EIchange.nrow - 1, model.NAchange.nrow - 1, model.PAL.nrow - 1)
+    if nsteps < 1:
+        raise ValueError("Invalid days. Please choose more days or inputs with more columns.")
+    options = _options(dt, nsteps, method, threads, qss)
+
+    if estimate is not None:
+        name, sums = _estimate((_lib.bw_adult_bootstrap, _lib.bw_adult_regression), model, options, estimate, n)
+        return {name: sums, "Correct_Values": bool(options.correct), "Model_Type": "Adult"}
+
+    names  = ["Adaptive_Thermogenesis", "Extracellular_Fluid", "Glycogen", "Lean_Mass",
+              "Fat_Mass", "Body_Weight", "Energy_Intake"]
+    states = [_trajectory(output, name, n, nsteps) for name in names]
+    _check(_lib.bw_adult_trajectories, ctypes.byref(model), ctypes.byref(options), _pointers(states))
+    result = {"Time": np.arange(nsteps + 1)*dt}
+    result["Age"] = np.asarray(age, dtype=np.float64)[:, None] + result["Time"][None, :]/365
+    result.update(zip(names, states))
+    result["Body_Mass_Index"] = result["Body_Weight"]/(ht**2)[:, None]
+    result.update({"Correct_Values": bool(options.correct), "Model_Type": "Adult"})
+    return result
+
+def _child(age, sex, bmiCat, FFM, FM, referenceValues, keep):
+    age    = np.atleast_1d(np.asarray(age, dtype=np.float64))
+    n      = age.size
+    bmiCat = np.atleast_1d(np.asarray(bmiCat, dtype=np.float64))
+    if np.size(sex) != n or bmiCat.shape != (n,):
+        raise ValueError("Dimension mismatch: age, sex and bmiCat must have same length.")
+    if not np.all(np.isin(bmiCat, [1, 2, 3, 4])):
+        raise ValueError("Invalid bmi category value (bmiCat). Please specify 1 for underweight, "
+                         "2 for normal weight, 3 for overweight, or 4 for obesity.")
+    if referenceValues not in ("mean", "median"):
+        raise ValueError("Invalid referenceValues. Please specify either 'mean' of 'median'")
+    return _Child(n, _vector(age, n, keep), _vector(_sex(sex), n, keep),
+                  _vector(bmiCat, n, keep), _vector(FFM, n, keep),
+                  _vector(FM, n, keep), int(referenceValues == "median"), _Input(None, 1, 0, 0, 0))
+
+def child_reference_FFMandFM(age, sex, bmiCat, referenceValues="median"):
+    """Reference fat free mass and fat mass of children (as child_reference_FFMandFM in R)."""
+    keep  = []
+    model = _child(age, sex, bmiCat, None, None, referenceValues, keep)
+    FFM, FM = np.empty(model.nind), np.empty(model.nind)
+    _check(_lib.bw_child_reference, ctypes.byref(model), _buffer(FFM), _buffer(FM))
+    return {"FFM": FFM, "FM": FM}
+
+def child_reference_EI(age, sex, bmiCat, days=365, dt=1, referenceValues="median"):
+    """Reference energy intake of children as an individuals x (floor(days/dt) + 1)
+    array (the transpose of child_reference_EI in R)."""
+    keep  = []
+    model = _child(age, sex, bmiCat, None, None, referenceValues, keep)
+    if days <= 0 or dt <= 0:
+        raise ValueError("Invalid days or dt. Please make sure days > 0 and dt > 0.")
+    if np.max(np.asarray(age)) + days/365 > 18:
+        raise ValueError("Age + days/365 should not exceed 18 years.")
+    nsteps = int(math.floor(days/dt))
+    EI     = np.empty((model.nind, nsteps + 1), order="F")
+    _check(_lib.bw_child_reference_EI, ctypes.byref(model), dt, nsteps, _buffer(EI))
+    return EI
+
+def child_weight(age, sex, bmiCat, FM=None, FFM=None, EI=None, days=365, dt=1,
+                 referenceValues="median", method="rk4", threads=1, growth="dynamic",
+                 estimate=None, output=None):
+    """Dynamic weight change model of children (Hall et al, 2013) as child_weight in R.
+
+    EI is an individuals x times array (default the reference intake of
+    child_reference_EI) and FM, FFM default to child_reference_FFMandFM. With
+    growth = "both" the trajectories have the individuals with the dynamic
+    growth function followed by those with the impact growth function. With
+    estimate (bootstrap_design or regression_design) only the estimates are kept.
+    """
+    keep      = []
+    reference = child_reference_FFMandFM(age, sex, bmiCat, referenceValues)
+    FFM       = reference["FFM"] if FFM is None else FFM
+    FM        = reference["FM"] if FM is None else FM
+    if EI is None:
+        EI = child_reference_EI(age, sex, bmiCat, days, dt, referenceValues)
+    model     = _child(age, sex, bmiCat, FFM, FM, referenceValues, keep)
+    n         = model.nind
+    if np.size(FFM) != n or np.size(FM) != n:
+        raise ValueError("Dimension mismatch: age, sex, FM and FFM must have same length.")
+    model.EI  = _input(EI, n, "EI", keep)
+    nsteps    = int(math.floor((days - 1)/dt))
+    if nsteps < 1 or model.EI.nrow < nsteps + 1:
+        raise ValueError("Invalid days. Please choose more days or an EI with more columns.")
+    growths   = ["dynamic", "impact", "both"]
+    if growth not in growths:
+        raise ValueError("Invalid growth. Please choose dynamic, impact or both.")
+    options   = _options(dt, nsteps, method, threads, growth=growths.index(growth))
+
+    if estimate is not None:
+        name, sums = _estimate((_lib.bw_child_bootstrap, _lib.bw_child_regression), model, options, estimate, n)
+        return {name: sums, "Correct_Values": bool(options.correct), "Model_Type": "Children"}
+
+    rows   = 2*n if growth == "both" else n
+    names  = ["Fat_Free_Mass", "Fat_Mass", "Body_Weight"]
+    states = [_trajectory(output, name, rows, nsteps) for name in names]
+    _check(_lib.bw_child_trajectories, ctypes.byref(model), ctypes.byref(options), _pointers(states))
+    result = {"Time": np.arange(nsteps + 1)*dt}
+    ages   = np.tile(np.asarray(age, dtype=np.float64), rows//n)
+    result["Age"] = ages[:, None] + result["Time"][None, :]/365
+    result.update(zip(names, states))
+    if growth == "both":
+        result["Growth"] = np.repeat(["dynamic", "impact"], n)
+    result.update({"Correct_Values": bool(options.correct), "Model_Type": "Children"})
+    return result
@@ -0,0 +1,55 @@
+#
+#  setup.py
+#
+#  Builds the Python bindings of the native engine of bw (bw_engine) from the
+#  sources of the R package: src/engine_api.cpp and the headers of the engine
+#  (none of them depends on R). Run from inst/python of the package sources:
+#
+#      pip install .
+#
+#  or set BW_SOURCES to the src directory of the package.
+#
+#  Authors:
+#  Dalia Camacho-García-Formentí
+#  Rodrigo Zepeda-Tello
+#
+#  License: MIT
+#  Copyright 2018 Instituto Nacional de Salud Pública de México
+#
+
+import os
+from setuptools import setup, Extension
+from setuptools.command.build_ext import build_ext
+
+here    = os.path.dirname(os.path.abspath(__file__))
+sources = os.environ.get("BW_SOURCES", os.path.join(here, "..", "..", "src"))
+if not os.path.exists(os.path.join(sources, "engine_api.cpp")):
+    raise RuntimeError("Sources of bw not found. Please set BW_SOURCES to the src directory of bw.")
+
+#The library is loaded with ctypes (it has no Python module init function): export
+#the functions of engine_api.h instead
+exports = ["bw_adult_trajectories", "bw_adult_bootstrap", "bw_adult_regression",
+           "bw_child_trajectories", "bw_child_bootstrap", "bw_child_regression",
+           "bw_child_reference", "bw_child_reference_EI"]
+
+class build_engine(build_ext):
+    def get_export_symbols(self, ext):
+        return exports
+
+windows = os.name == "nt"
+engine  = Extension("bw_engine._engine",
+                    sources=[os.path.join(os.path.abspath(sources), "engine_api.cpp")],
+                    include_dirs=[sources],
+                    language="c++",
+                    extra_compile_args=[] if windows else ["-std=c++11", "-O2", "-pthread"],
+                    extra_link_args=[] if windows else ["-pthread"])
+
+setup(name="bw_engine",
+      version="1.0.1",
+      description="Python bindings of the native engine of the bw dynamic body weight models",
+      author="Dalia Camacho-García-Formentí, Rodrigo Zepeda-Tello",
+      license="MIT",
+      packages=["bw_engine"],
+      ext_modules=[engine],
+      cmdclass={"build_ext": build_engine},
+      install_requires=["numpy"])
@@ -6,8 +6,8 @@
 using namespace Rcpp;
 
 // adult_weight_wrapper
-List adult_weight_wrapper(NumericVector bw, NumericVector ht, NumericVector age, NumericVector sex, NumericMatrix EIchange, NumericMatrix NAchange, NumericMatrix PAL, NumericVector pcarb_base, NumericVector pcarb, double dt, double days, bool checkValues);
-RcppExport SEXP _bw_adult_weight_wrapper(SEXP bwSEXP, SEXP htSEXP, SEXP ageSEXP, SEXP sexSEXP, SEXP EIchangeSEXP, SEXP NAchangeSEXP, SEXP PALSEXP, SEXP pcarb_baseSEXP, SEXP pcarbSEXP, SEXP dtSEXP, SEXP daysSEXP, SEXP checkValuesSEXP) {
+List adult_weight_wrapper(NumericVector bw, NumericVector ht, NumericVector age, NumericVector sex, SEXP EIchange, SEXP NAchange, SEXP PAL, NumericVector pcarb_base, NumericVector pcarb, double dt, double days, bool checkValues, bool allocations, std::string method, int nthreads, bool qss, std::string output, SEXP regression, SEXP bootstrap, SEXP window, SEXP contrast);
+RcppExport SEXP _bw_adult_weight_wrapper(SEXP bwSEXP, SEXP htSEXP, SEXP ageSEXP, SEXP sexSEXP, SEXP EIchangeSEXP, SEXP NAchangeSEXP, SEXP PALSEXP, SEXP pcarb_baseSEXP, SEXP pcarbSEXP, SEXP dtSEXP, SEXP daysSEXP, SEXP checkValuesSEXP, SEXP allocationsSEXP, SEXP methodSEXP, SEXP nthreadsSEXP, SEXP qssSEXP, SEXP outputSEXP, SEXP regressionSEXP, SEXP bootstrapSEXP, SEXP windowSEXP, SEXP contrastSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -15,21 +15,30 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type ht(htSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type age(ageSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type sex(sexSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type EIchange(EIchangeSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type NAchange(NAchangeSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type PAL(PALSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type EIchange(EIchangeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type NAchange(NAchangeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type PAL(PALSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pcarb_base(pcarb_baseSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pcarb(pcarbSEXP);
     Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
     Rcpp::traits::input_parameter< double >::type days(daysSEXP);
     Rcpp::traits::input_parameter< bool >::type checkValues(checkValuesSEXP);
-    rcpp_result_gen = Rcpp::wrap(adult_weight_wrapper(bw, ht, age, sex, EIchange, NAchange, PAL, pcarb_base, pcarb, dt, days, checkValues));
+    Rcpp::traits::input_parameter< bool >::type allocations(allocationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type qss(qssSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type regression(regressionSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type bootstrap(bootstrapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type window(windowSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type contrast(contrastSEXP);
+    rcpp_result_gen = Rcpp::wrap(adult_weight_wrapper(bw, ht, age, sex, EIchange, NAchange, PAL, pcarb_base, pcarb, dt, days, checkValues, allocations, method, nthreads, qss, output, regression, bootstrap, window, contrast));
     return rcpp_result_gen;
 END_RCPP
 }
 // adult_weight_wrapper_EI
-List adult_weight_wrapper_EI(NumericVector bw, NumericVector ht, NumericVector age, NumericVector sex, NumericMatrix EIchange, NumericMatrix NAchange, NumericMatrix PAL, NumericVector pcarb_base, NumericVector pcarb, double dt, NumericVector extradata, double days, bool checkValues, bool isEnergy);
-RcppExport SEXP _bw_adult_weight_wrapper_EI(SEXP bwSEXP, SEXP htSEXP, SEXP ageSEXP, SEXP sexSEXP, SEXP EIchangeSEXP, SEXP NAchangeSEXP, SEXP PALSEXP, SEXP pcarb_baseSEXP, SEXP pcarbSEXP, SEXP dtSEXP, SEXP extradataSEXP, SEXP daysSEXP, SEXP checkValuesSEXP, SEXP isEnergySEXP) {
+List adult_weight_wrapper_EI(NumericVector bw, NumericVector ht, NumericVector age, NumericVector sex, SEXP EIchange, SEXP NAchange, SEXP PAL, NumericVector pcarb_base, NumericVector pcarb, double dt, NumericVector extradata, double days, bool checkValues, bool isEnergy, bool allocations, std::string method, int nthreads, bool qss, std::string output, SEXP regression, SEXP bootstrap, SEXP window, SEXP contrast);
+RcppExport SEXP _bw_adult_weight_wrapper_EI(SEXP bwSEXP, SEXP htSEXP, SEXP ageSEXP, SEXP sexSEXP, SEXP EIchangeSEXP, SEXP NAchangeSEXP, SEXP PALSEXP, SEXP pcarb_baseSEXP, SEXP pcarbSEXP, SEXP dtSEXP, SEXP extradataSEXP, SEXP daysSEXP, SEXP checkValuesSEXP, SEXP isEnergySEXP, SEXP allocationsSEXP, SEXP methodSEXP, SEXP nthreadsSEXP, SEXP qssSEXP, SEXP outputSEXP, SEXP regressionSEXP, SEXP bootstrapSEXP, SEXP windowSEXP, SEXP contrastSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -37,9 +46,9 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type ht(htSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type age(ageSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type sex(sexSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type EIchange(EIchangeSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type NAchange(NAchangeSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type PAL(PALSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type EIchange(EIchangeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type NAchange(NAchangeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type PAL(PALSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pcarb_base(pcarb_baseSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pcarb(pcarbSEXP);
     Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
@@ -47,13 +56,22 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type days(daysSEXP);
     Rcpp::traits::input_parameter< bool >::type checkValues(checkValuesSEXP);
     Rcpp::traits::input_parameter< bool >::type isEnergy(isEnergySEXP);
-    rcpp_result_gen = Rcpp::wrap(adult_weight_wrapper_EI(bw, ht, age, sex, EIchange, NAchange, PAL, pcarb_base, pcarb, dt, extradata, days, checkValues, isEnergy));
+    Rcpp::traits::input_parameter< bool >::type allocations(allocationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type qss(qssSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type regression(regressionSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type bootstrap(bootstrapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type window(windowSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type contrast(contrastSEXP);
+    rcpp_result_gen = Rcpp::wrap(adult_weight_wrapper_EI(bw, ht, age, sex, EIchange, NAchange, PAL, pcarb_base, pcarb, dt, extradata, days, checkValues, isEnergy, allocations, method, nthreads, qss, output, regression, bootstrap, window, contrast));
     return rcpp_result_gen;
 END_RCPP
 }
 // adult_weight_wrapper_EI_fat
-List adult_weight_wrapper_EI_fat(NumericVector bw, NumericVector ht, NumericVector age, NumericVector sex, NumericMatrix EIchange, NumericMatrix NAchange, NumericMatrix PAL, NumericVector pcarb_base, NumericVector pcarb, double dt, NumericVector input_EI, NumericVector input_fat, double days, bool checkValues);
-RcppExport SEXP _bw_adult_weight_wrapper_EI_fat(SEXP bwSEXP, SEXP htSEXP, SEXP ageSEXP, SEXP sexSEXP, SEXP EIchangeSEXP, SEXP NAchangeSEXP, SEXP PALSEXP, SEXP pcarb_baseSEXP, SEXP pcarbSEXP, SEXP dtSEXP, SEXP input_EISEXP, SEXP input_fatSEXP, SEXP daysSEXP, SEXP checkValuesSEXP) {
+List adult_weight_wrapper_EI_fat(NumericVector bw, NumericVector ht, NumericVector age, NumericVector sex, SEXP EIchange, SEXP NAchange, SEXP PAL, NumericVector pcarb_base, NumericVector pcarb, double dt, NumericVector input_EI, NumericVector input_fat, double days, bool checkValues, bool allocations, std::string method, int nthreads, bool qss, std::string output, SEXP regression, SEXP bootstrap, SEXP window, SEXP contrast);
+RcppExport SEXP _bw_adult_weight_wrapper_EI_fat(SEXP bwSEXP, SEXP htSEXP, SEXP ageSEXP, SEXP sexSEXP, SEXP EIchangeSEXP, SEXP NAchangeSEXP, SEXP PALSEXP, SEXP pcarb_baseSEXP, SEXP pcarbSEXP, SEXP dtSEXP, SEXP input_EISEXP, SEXP input_fatSEXP, SEXP daysSEXP, SEXP checkValuesSEXP, SEXP allocationsSEXP, SEXP methodSEXP, SEXP nthreadsSEXP, SEXP qssSEXP, SEXP outputSEXP, SEXP regressionSEXP, SEXP bootstrapSEXP, SEXP windowSEXP, SEXP contrastSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -61,9 +79,9 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type ht(htSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type age(ageSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type sex(sexSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type EIchange(EIchangeSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type NAchange(NAchangeSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type PAL(PALSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type EIchange(EIchangeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type NAchange(NAchangeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type PAL(PALSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pcarb_base(pcarb_baseSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pcarb(pcarbSEXP);
     Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
@@ -71,13 +89,72 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type input_fat(input_fatSEXP);
     Rcpp::traits::input_parameter< double >::type days(daysSEXP);
     Rcpp::traits::input_parameter< bool >::type checkValues(checkValuesSEXP);
-    rcpp_result_gen = Rcpp::wrap(adult_weight_wrapper_EI_fat(bw, ht, age, sex, EIchange, NAchange, PAL, pcarb_base, pcarb, dt, input_EI, input_fat, days, checkValues));
+    Rcpp::traits::input_parameter< bool >::type allocations(allocationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type qss(qssSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type regression(regressionSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type bootstrap(bootstrapSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type window(windowSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type contrast(contrastSEXP);
+    rcpp_result_gen = Rcpp::wrap(adult_weight_wrapper_EI_fat(bw, ht, age, sex, EIchange, NAchange, PAL, pcarb_base, pcarb, dt, input_EI, input_fat, days, checkValues, allocations, method, nthreads, qss, output, regression, bootstrap, window, contrast));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bitmap_column_wrapper
+List bitmap_column_wrapper(IntegerVector codes, int nlevels);
+RcppExport SEXP _bw_bitmap_column_wrapper(SEXP codesSEXP, SEXP nlevelsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type codes(codesSEXP);
+    Rcpp::traits::input_parameter< int >::type nlevels(nlevelsSEXP);
+    rcpp_result_gen = Rcpp::wrap(bitmap_column_wrapper(codes, nlevels));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bitmap_combine_wrapper
+RawVector bitmap_combine_wrapper(RawVector x, RawVector y, double n, std::string op);
+RcppExport SEXP _bw_bitmap_combine_wrapper(SEXP xSEXP, SEXP ySEXP, SEXP nSEXP, SEXP opSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< RawVector >::type x(xSEXP);
+    Rcpp::traits::input_parameter< RawVector >::type y(ySEXP);
+    Rcpp::traits::input_parameter< double >::type n(nSEXP);
+    Rcpp::traits::input_parameter< std::string >::type op(opSEXP);
+    rcpp_result_gen = Rcpp::wrap(bitmap_combine_wrapper(x, y, n, op));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bitmap_rows_wrapper
+IntegerVector bitmap_rows_wrapper(RawVector x, double n);
+RcppExport SEXP _bw_bitmap_rows_wrapper(SEXP xSEXP, SEXP nSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< RawVector >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type n(nSEXP);
+    rcpp_result_gen = Rcpp::wrap(bitmap_rows_wrapper(x, n));
+    return rcpp_result_gen;
+END_RCPP
+}
+// bitmap_count_wrapper
+double bitmap_count_wrapper(RawVector x, double n);
+RcppExport SEXP _bw_bitmap_count_wrapper(SEXP xSEXP, SEXP nSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< RawVector >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type n(nSEXP);
+    rcpp_result_gen = Rcpp::wrap(bitmap_count_wrapper(x, n));
     return rcpp_result_gen;
 END_RCPP
 }
 // child_weight_wrapper
-List child_weight_wrapper(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, NumericMatrix input_EIntake, double days, double dt, bool checkValues, double referenceValues);
-RcppExport SEXP _bw_child_weight_wrapper(SEXP ageSEXP, SEXP sexSEXP, SEXP bmiCatSEXP, SEXP FFMSEXP, SEXP FMSEXP, SEXP input_EIntakeSEXP, SEXP daysSEXP, SEXP dtSEXP, SEXP checkValuesSEXP, SEXP referenceValuesSEXP) {
+List child_weight_wrapper(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, SEXP input_EIntake, double days, double dt, bool checkValues, double referenceValues, bool allocations, std::string method, int nthreads, NumericVector reference, int growth, std::string output, SEXP regression, SEXP bootstrap);
+RcppExport SEXP _bw_child_weight_wrapper(SEXP ageSEXP, SEXP sexSEXP, SEXP bmiCatSEXP, SEXP FFMSEXP, SEXP FMSEXP, SEXP input_EIntakeSEXP, SEXP daysSEXP, SEXP dtSEXP, SEXP checkValuesSEXP, SEXP referenceValuesSEXP, SEXP allocationsSEXP, SEXP methodSEXP, SEXP nthreadsSEXP, SEXP referenceSEXP, SEXP growthSEXP, SEXP outputSEXP, SEXP regressionSEXP, SEXP bootstrapSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -86,18 +163,26 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type bmiCat(bmiCatSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type FFM(FFMSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type FM(FMSEXP);
-    Rcpp::traits::input_parameter< NumericMatrix >::type input_EIntake(input_EIntakeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type input_EIntake(input_EIntakeSEXP);
     Rcpp::traits::input_parameter< double >::type days(daysSEXP);
     Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
     Rcpp::traits::input_parameter< bool >::type checkValues(checkValuesSEXP);
     Rcpp::traits::input_parameter< double >::type referenceValues(referenceValuesSEXP);
-    rcpp_result_gen = Rcpp::wrap(child_weight_wrapper(age, sex, bmiCat, FFM, FM, input_EIntake, days, dt, checkValues, referenceValues));
+    Rcpp::traits::input_parameter< bool >::type allocations(allocationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type reference(referenceSEXP);
+    Rcpp::traits::input_parameter< int >::type growth(growthSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type regression(regressionSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type bootstrap(bootstrapSEXP);
+    rcpp_result_gen = Rcpp::wrap(child_weight_wrapper(age, sex, bmiCat, FFM, FM, input_EIntake, days, dt, checkValues, referenceValues, allocations, method, nthreads, reference, growth, output, regression, bootstrap));
     return rcpp_result_gen;
 END_RCPP
 }
 // child_weight_wrapper_richardson
-List child_weight_wrapper_richardson(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, double K, double Q, double A, double B, double nu, double C, double days, double dt, bool checkValues, double referenceValues);
-RcppExport SEXP _bw_child_weight_wrapper_richardson(SEXP ageSEXP, SEXP sexSEXP,  SEXP bmiCatSEXP, SEXP FFMSEXP, SEXP FMSEXP, SEXP KSEXP, SEXP QSEXP, SEXP ASEXP, SEXP BSEXP, SEXP nuSEXP, SEXP CSEXP, SEXP daysSEXP, SEXP dtSEXP, SEXP checkValuesSEXP, SEXP referenceValuesSEXP) {
+List child_weight_wrapper_richardson(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, double K, double Q, double A, double B, double nu, double C, double days, double dt, bool checkValues, double referenceValues, bool allocations, std::string method, int nthreads, NumericVector reference, int growth, std::string output, SEXP regression, SEXP bootstrap);
+RcppExport SEXP _bw_child_weight_wrapper_richardson(SEXP ageSEXP, SEXP sexSEXP, SEXP bmiCatSEXP, SEXP FFMSEXP, SEXP FMSEXP, SEXP KSEXP, SEXP QSEXP, SEXP ASEXP, SEXP BSEXP, SEXP nuSEXP, SEXP CSEXP, SEXP daysSEXP, SEXP dtSEXP, SEXP checkValuesSEXP, SEXP referenceValuesSEXP, SEXP allocationsSEXP, SEXP methodSEXP, SEXP nthreadsSEXP, SEXP referenceSEXP, SEXP growthSEXP, SEXP outputSEXP, SEXP regressionSEXP, SEXP bootstrapSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -116,7 +201,15 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
     Rcpp::traits::input_parameter< bool >::type checkValues(checkValuesSEXP);
     Rcpp::traits::input_parameter< double >::type referenceValues(referenceValuesSEXP);
-    rcpp_result_gen = Rcpp::wrap(child_weight_wrapper_richardson(age, sex, bmiCat, FFM, FM, K, Q, A, B, nu, C, days, dt, checkValues, referenceValues));
+    Rcpp::traits::input_parameter< bool >::type allocations(allocationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type reference(referenceSEXP);
+    Rcpp::traits::input_parameter< int >::type growth(growthSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type regression(regressionSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type bootstrap(bootstrapSEXP);
+    rcpp_result_gen = Rcpp::wrap(child_weight_wrapper_richardson(age, sex, bmiCat, FFM, FM, K, Q, A, B, nu, C, days, dt, checkValues, referenceValues, allocations, method, nthreads, reference, growth, output, regression, bootstrap));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -133,14 +226,14 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type FM(FMSEXP);
     Rcpp::traits::input_parameter< double >::type days(daysSEXP);
     Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
-    Rcpp::traits::input_parameter< double >::type  referenceValues(referenceValuesSEXP);
+    Rcpp::traits::input_parameter< double >::type referenceValues(referenceValuesSEXP);
     rcpp_result_gen = Rcpp::wrap(intake_reference_wrapper(age, sex, bmiCat, FFM, FM, days, dt, referenceValues));
     return rcpp_result_gen;
 END_RCPP
 }
 // mass_reference_wrapper
 List mass_reference_wrapper(NumericVector age, NumericVector sex, NumericVector bmiCat, double referenceValues);
-RcppExport SEXP _bw_mass_reference_wrapper(SEXP ageSEXP, SEXP sexSEXP, SEXP bmiCatSEXP, SEXP  referenceValuesSEXP) {
+RcppExport SEXP _bw_mass_reference_wrapper(SEXP ageSEXP, SEXP sexSEXP, SEXP bmiCatSEXP, SEXP referenceValuesSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -165,20 +258,121 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// intake_file_write_wrapper
+void intake_file_write_wrapper(NumericMatrix input, std::string path, bool timeInRows, int type);
+RcppExport SEXP _bw_intake_file_write_wrapper(SEXP inputSEXP, SEXP pathSEXP, SEXP timeInRowsSEXP, SEXP typeSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type input(inputSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< bool >::type timeInRows(timeInRowsSEXP);
+    Rcpp::traits::input_parameter< int >::type type(typeSEXP);
+    intake_file_write_wrapper(input, path, timeInRows, type);
+    return R_NilValue;
+END_RCPP
+}
+// intake_file_info_wrapper
+List intake_file_info_wrapper(std::string path);
+RcppExport SEXP _bw_intake_file_info_wrapper(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(intake_file_info_wrapper(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// intake_file_range_wrapper
+NumericVector intake_file_range_wrapper(std::string path);
+RcppExport SEXP _bw_intake_file_range_wrapper(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(intake_file_range_wrapper(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_contrast_wrapper
+List model_contrast_wrapper(NumericMatrix scenario, NumericMatrix baseline, IntegerVector columns, List design);
+RcppExport SEXP _bw_model_contrast_wrapper(SEXP scenarioSEXP, SEXP baselineSEXP, SEXP columnsSEXP, SEXP designSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type scenario(scenarioSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type baseline(baselineSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< List >::type design(designSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_contrast_wrapper(scenario, baseline, columns, design));
+    return rcpp_result_gen;
+END_RCPP
+}
+// population_weight_wrapper
+List population_weight_wrapper(List adult, List child, double dt, int nsteps, std::string method, int nthreads, bool qss, int growth, SEXP regression, SEXP bootstrap);
+RcppExport SEXP _bw_population_weight_wrapper(SEXP adultSEXP, SEXP childSEXP, SEXP dtSEXP, SEXP nstepsSEXP, SEXP methodSEXP, SEXP nthreadsSEXP, SEXP qssSEXP, SEXP growthSEXP, SEXP regressionSEXP, SEXP bootstrapSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type adult(adultSEXP);
+    Rcpp::traits::input_parameter< List >::type child(childSEXP);
+    Rcpp::traits::input_parameter< double >::type dt(dtSEXP);
+    Rcpp::traits::input_parameter< int >::type nsteps(nstepsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type qss(qssSEXP);
+    Rcpp::traits::input_parameter< int >::type growth(growthSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type regression(regressionSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type bootstrap(bootstrapSEXP);
+    rcpp_result_gen = Rcpp::wrap(population_weight_wrapper(adult, child, dt, nsteps, method, nthreads, qss, growth, regression, bootstrap));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_write_wrapper
+void model_write_wrapper(List variables, NumericVector ids, NumericVector times, IntegerVector columns, std::string file, bool wide, std::string sep, int digits, bool gzip, int level, int nthreads);
+RcppExport SEXP _bw_model_write_wrapper(SEXP variablesSEXP, SEXP idsSEXP, SEXP timesSEXP, SEXP columnsSEXP, SEXP fileSEXP, SEXP wideSEXP, SEXP sepSEXP, SEXP digitsSEXP, SEXP gzipSEXP, SEXP levelSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type variables(variablesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type ids(idsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type wide(wideSEXP);
+    Rcpp::traits::input_parameter< std::string >::type sep(sepSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type gzip(gzipSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    model_write_wrapper(variables, ids, times, columns, file, wide, sep, digits, gzip, level, nthreads);
+    return R_NilValue;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_bw_adult_weight_wrapper", (DL_FUNC) &_bw_adult_weight_wrapper, 12},
-    {"_bw_adult_weight_wrapper_EI", (DL_FUNC) &_bw_adult_weight_wrapper_EI, 14},
-    {"_bw_adult_weight_wrapper_EI_fat", (DL_FUNC) &_bw_adult_weight_wrapper_EI_fat, 14},
-    {"_bw_child_weight_wrapper", (DL_FUNC) &_bw_child_weight_wrapper, 10},
-    {"_bw_child_weight_wrapper_richardson", (DL_FUNC) &_bw_child_weight_wrapper_richardson, 15},
+    {"_bw_adult_weight_wrapper", (DL_FUNC) &_bw_adult_weight_wrapper, 21},
+    {"_bw_adult_weight_wrapper_EI", (DL_FUNC) &_bw_adult_weight_wrapper_EI, 23},
+    {"_bw_adult_weight_wrapper_EI_fat", (DL_FUNC) &_bw_adult_weight_wrapper_EI_fat, 23},
+    {"_bw_bitmap_column_wrapper", (DL_FUNC) &_bw_bitmap_column_wrapper, 2},
+    {"_bw_bitmap_combine_wrapper", (DL_FUNC) &_bw_bitmap_combine_wrapper, 4},
+    {"_bw_bitmap_rows_wrapper", (DL_FUNC) &_bw_bitmap_rows_wrapper, 2},
+    {"_bw_bitmap_count_wrapper", (DL_FUNC) &_bw_bitmap_count_wrapper, 2},
+    {"_bw_child_weight_wrapper", (DL_FUNC) &_bw_child_weight_wrapper, 18},
+    {"_bw_child_weight_wrapper_richardson", (DL_FUNC) &_bw_child_weight_wrapper_richardson, 23},
     {"_bw_intake_reference_wrapper", (DL_FUNC) &_bw_intake_reference_wrapper, 8},
     {"_bw_mass_reference_wrapper", (DL_FUNC) &_bw_mass_reference_wrapper, 4},
     {"_bw_EnergyBuilder", (DL_FUNC) &_bw_EnergyBuilder, 3},
+    {"_bw_intake_file_write_wrapper", (DL_FUNC) &_bw_intake_file_write_wrapper, 4},
+    {"_bw_intake_file_info_wrapper", (DL_FUNC) &_bw_intake_file_info_wrapper, 1},
+    {"_bw_intake_file_range_wrapper", (DL_FUNC) &_bw_intake_file_range_wrapper, 1},
+    {"_bw_model_contrast_wrapper", (DL_FUNC) &_bw_model_contrast_wrapper, 4},
+    {"_bw_population_weight_wrapper", (DL_FUNC) &_bw_population_weight_wrapper, 10},
+    {"_bw_model_write_wrapper", (DL_FUNC) &_bw_model_write_wrapper, 11},
     {NULL, NULL, 0}
 };
 
+void result_file_init(DllInfo* dll);
 RcppExport void R_init_bw(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    result_file_init(dll);
 }
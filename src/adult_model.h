@@ -0,0 +1,457 @@
+//
+//  adult_model.h
+//
+//  This is a function that defines the native derivative kernel of the
+//  adult weight model (Chow & Hall 2008; Hall et al. 2011) for the engine in
+//  ode_engine.h. It has the same equations as Adult::dAT, Adult::dECF,
+//  Adult::dG and Adult::dL (adult_weight.cpp) written as a loop over a block
+//  of individuals on plain arrays so that it can run in worker threads.
+//  Kernels are built on the main thread from an Adult with Adult::nativeModel().
+//  The constants of individuals at baseline (Adult::build) are computed in one
+//  pass over blocks of individuals by AdultModel::baseline into aligned vectors
+//  (aligned_vector.h) so that the setup of large populations can also run in
+//  worker threads.
+//
+//  States (nstates = 4):
+//  0               .-  Adaptive Thermogenesis
+//  1               .-  Extracellular Fluid (kg)
+//  2               .-  Glycogen (kg)
+//  3               .-  Lean Mass (kg)
+//
+//  AdultQSSModel is the reduced model (nstates = 2: AT and L) in which
+//  glycogen and extracellular fluid are replaced by their quasi steady
+//  states (see below).
+//
+//  Note:
+//  Adult::rk4 integrates AT, ECF and G first and uses their average over the
+//  step for the stages of L. The engine integrates the four states together.
+//  AT, ECF and G do not depend on L so only L can differ (by the error of
+//  the averages).
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef adult_model_h
+#define adult_model_h
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "input_view.h"
+#include "aligned_vector.h"
+
+//Arrays of individuals from which AdultModel::baseline builds the model
+//--------------------------------------------------------------------------------
+struct AdultArrays {
+    const double* bw;         //Weight (kg)
+    const double* ht;         //Height (m)
+    const double* age;        //Age (yrs)
+    const double* sex;        //0 = "male"; 1 = "female"
+    const double* pcarb_base; //% carbohydrates at baseline
+    const double* pcarb;      //% carbohydrates after change
+    const double* EI;         //Energy intake at baseline (kcal; NULL to estimate)
+    const double* fat;        //Fat mass at baseline (kg; NULL to estimate)
+};
+
+class AdultModel {
+public:
+
+    static const int nstates = 4;
+
+    //Individual constants
+    AlignedVector ht;       //Height (m)
+    AlignedVector age;      //Age (yrs)
+    AlignedVector sex;      //0 = "male"; 1 = "female"
+    AlignedVector EI;       //Energy intake at baseline (kcal)
+    AlignedVector fat;      //Fat mass at baseline (kg)
+    AlignedVector lean;     //Lean mass at baseline (kg)
+    AlignedVector ecfinit;  //Extracellular fluid at baseline (kg)
+    AlignedVector G_base;   //Glycogen at baseline (kg)
+    AlignedVector atinit;   //Adaptive thermogenesis at baseline
+    AlignedVector CIb;      //Carbohydrate intake at baseline (kcal)
+    AlignedVector kG;       //Glycogen constant
+    AlignedVector K;        //Energy balance constant
+    AlignedVector pcarb;    //% carbohydrates after change
+
+    //Inputs (views of matrices or files)
+    InputView EIchange;
+    InputView NAchange;
+    InputView PAL;
+
+    //Constants
+    double roG, Na, zetaNa, zetaCI, roF, roL, gammaF, gammaL, etaF, etaL;
+    double betaTEF, betaAT, tauAT, C, alfa1, alfa2;
+    double dt;
+
+    int size(void) const {
+        return age.size();
+    }
+
+    void check(int nsteps) const {
+        EIchange.check(nsteps, "EIchange");
+        NAchange.check(nsteps, "NAchange");
+        PAL.check(nsteps, "PAL");
+    }
+
+    //Size the constants of nind individuals before AdultModel::baseline (values
+    //are not initialized)
+    void resizeBaseline(int nind){
+        ht.resize(nind);
+        age.resize(nind);
+        sex.resize(nind);
+        pcarb.resize(nind);
+        EI.resize(nind);
+        fat.resize(nind);
+        lean.resize(nind);
+        ecfinit.resize(nind);
+        G_base.resize(nind);
+        atinit.resize(nind);
+        CIb.resize(nind);
+        kG.resize(nind);
+        K.resize(nind);
+    }
+
+    //Constants of individuals first, ..., first + n - 1 in one pass from the arrays
+    //of the caller (energy intake and fat mass are estimated when in.EI and in.fat
+    //are NULL). Needs PAL, gammaF, gammaL and betaTEF. Loops only over plain arrays
+    //(no calls to R) so blocks can be computed in worker threads.
+    void baseline(const AdultArrays& in, int first, int n){
+        for (int j = first; j < first + n; j++){
+            double w   = in.bw[j];
+            double h   = in.ht[j];
+            double a   = in.age[j];
+            double s   = in.sex[j];
+            double pal = PAL(0, j);
+            ht[j]      = h;
+            age[j]     = a;
+            sex[j]     = s;
+            pcarb[j]   = in.pcarb[j];
+
+            //Resting metabolic rate from Mifflin & St Jeor (sex = 0 => "male" and
+            //sex = 1 => "female") and extracellular fluid by Silva's equation
+            double rmr = (9.99*w + 625.0*h - 4.92*a + 5.0)*(1.0 - s) +
+                         (9.99*w + 625.0*h - 4.92*a - 161.0)*s;
+            ecfinit[j] = (0.025*a + 9.57*h + 0.191*w - 12.4)*(1.0 - s) + (-4.0 + 5.98*h + 0.167*w)*s;
+
+            //Personal communication with Hall: since the model starts in a state of
+            //energy balance AT(0) = 0 and energy intake is the expenditure PAL*RMR
+            G_base[j]  = 0.5;
+            atinit[j]  = 0.0;
+            EI[j]      = (in.EI != NULL) ? in.EI[j] : rmr*pal;
+
+            //Fat from body mass index; lean mass is the difference between the initial
+            //BW, F, ECF and G and its associated water
+            double logbmi = std::log(w/(h*h));
+            fat[j]     = (in.fat != NULL) ? in.fat[j] :
+                         (w*(0.14*a + 37.31*logbmi - 103.94)/100.0)*(1.0 - s) +
+                         (w*(0.14*a + 39.96*logbmi - 102.01)/100.0)*s;
+            lean[j]    = w - (ecfinit[j] + fat[j] + 3.7*G_base[j]);
+
+            //Hall personal communication: energy expenditure at the baseline balance is
+            //PAL*RMR and delta at baseline (equation 8) gives K
+            K[j]       = rmr*pal - gammaL*lean[j] - gammaF*fat[j] - ((1.0 - betaTEF)*pal - 1.0)*rmr;
+            CIb[j]     = in.pcarb_base[j]*EI[j];
+            kG[j]      = CIb[j]/(G_base[j]*G_base[j]);
+        }
+    }
+
+    void initial(double* y, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            y[j]       = atinit[first + j];
+            y[n + j]   = ecfinit[first + j];
+            y[2*n + j] = G_base[first + j];
+            y[3*n + j] = lean[first + j];
+        }
+    }
+
+    //Row of inputs at time t
+    inline int row(double t) const {
+        return (int) std::floor(t/dt + 1.0e-9);
+    }
+
+    inline double fatMass(int i, double L) const {
+        return fat[i]*std::exp(roL*(L - lean[i])/(roF*C));
+    }
+
+    inline double TotalIntake(int i, double t) const {
+        return EI[i] + EIchange(row(t), i);
+    }
+
+    //Body weight of individual i (state j of block of n)
+    inline double bodyWeight(int i, double t, const double* y, int j, int n) const {
+        double L = y[3*n + j];
+        return fatMass(i, L) + L + y[n + j] + 3.7*y[2*n + j];
+    }
+
+    //Outputs of individual i (AT, ECF, G, L, F, BW, BMI and intake; see window_sink.h)
+    static const int noutputs = 8;
+    inline void outputs(int i, double t, const double* y, int j, int n, double* v) const {
+        v[0] = y[j];
+        v[1] = y[n + j];
+        v[2] = y[2*n + j];
+        v[3] = y[3*n + j];
+        v[4] = fatMass(i, v[3]);
+        v[5] = v[4] + v[3] + v[1] + 3.7*v[2];
+        v[6] = v[5]/(ht[i]*ht[i]);
+        v[7] = (t > 0.0) ? TotalIntake(i, t) : EI[i];
+    }
+
+    //Batch derivative kernel
+    void derivatives(double t, const double* y, double* dy, int first, int n) const {
+        int r = row(t);
+        for (int j = 0; j < n; j++){
+            int    i    = first + j;
+            double AT   = y[j];
+            double ECF  = y[n + j];
+            double G    = y[2*n + j];
+            double L    = y[3*n + j];
+            double dEI  = EIchange(r, i);
+            double TI   = EI[i] + dEI;
+            double CI   = pcarb[i]*TI;
+            double dG   = (CI - kG[i]*G*G)/roG;
+            double F    = fatMass(i, L);
+            double rmr  = 9.99*(F + L + 3.7*G + ECF) + 625*ht[i] - 4.92*(age[i] + t/365) + 5 - 166*sex[i];
+            double delta_times_bw = ((1 - betaTEF)*PAL(r, i) - 1)*rmr;
+            double R3   = K[i] + delta_times_bw + betaTEF*dEI + AT - TI + dG;
+            double R    = (R3 + gammaL*L + gammaF*F)/(alfa1 + alfa2*F);
+            dy[j]       = (betaAT*dEI - AT)*(1.0/tauAT);
+            dy[n + j]   = (NAchange(r, i) - zetaNa*(ECF - ecfinit[i]) - zetaCI*(1.0 - CI/CIb[i]))/Na;
+            dy[2*n + j] = dG;
+            dy[3*n + j] = R*(C/roL);
+        }
+    }
+
+    //Stiff part: relaxation of AT and ECF and glycogen consumption
+    void implicitDerivatives(double t, const double* y, double* dy, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            int i = first + j;
+            double G    = y[2*n + j];
+            dy[j]       = -y[j]/tauAT;
+            dy[n + j]   = -zetaNa*(y[n + j] - ecfinit[i])/Na;
+            dy[2*n + j] = -kG[i]*G*G/roG;
+            dy[3*n + j] = 0.0;
+        }
+    }
+
+    //Analytic Jacobian for the Rosenbrock method (d f_k/d y_l at J[(4*k + l)*n + j]).
+    //AT, ECF and G depend only on themselves; L depends on all states.
+    void jacobian(double t, const double* y, double* J, int first, int n) const {
+        std::fill(J, J + nstates*nstates*n, 0.0);
+        int r = row(t);
+        for (int j = 0; j < n; j++){
+            int    i    = first + j;
+            double AT   = y[j];
+            double ECF  = y[n + j];
+            double G    = y[2*n + j];
+            double L    = y[3*n + j];
+            double dEI  = EIchange(r, i);
+            double TI   = EI[i] + dEI;
+            double CI   = pcarb[i]*TI;
+            double dG   = (CI - kG[i]*G*G)/roG;
+            double ddG  = -2.0*kG[i]*G/roG;
+            double F    = fatMass(i, L);
+            double dF   = F*roL/(roF*C);
+            double rmr  = 9.99*(F + L + 3.7*G + ECF) + 625*ht[i] - 4.92*(age[i] + t/365) + 5 - 166*sex[i];
+            double w    = (1 - betaTEF)*PAL(r, i) - 1;
+            double R3   = K[i] + w*rmr + betaTEF*dEI + AT - TI + dG;
+            double D    = alfa1 + alfa2*F;
+            double R    = (R3 + gammaL*L + gammaF*F)/D;
+            J[j]        = -1.0/tauAT;
+            J[5*n + j]  = -zetaNa/Na;
+            J[10*n + j] = ddG;
+            J[12*n + j] = (C/roL)/D;
+            J[13*n + j] = (C/roL)*9.99*w/D;
+            J[14*n + j] = (C/roL)*(9.99*3.7*w + ddG)/D;
+            J[15*n + j] = (C/roL)*((9.99*w*(dF + 1.0) + gammaL + gammaF*dF) - R*alfa2*dF)/D;
+        }
+    }
+
+    //Solve y - a*implicitDerivatives(y) = r (linear for AT and ECF; quadratic for G)
+    void implicitSolve(double t, double a, const double* r, double* y, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            int i = first + j;
+            double q    = a*kG[i]/roG;
+            y[j]        = r[j]/(1.0 + a/tauAT);
+            y[n + j]    = (r[n + j] + a*zetaNa*ecfinit[i]/Na)/(1.0 + a*zetaNa/Na);
+            y[2*n + j]  = (q > 0.0) ? 2.0*r[2*n + j]/(1.0 + std::sqrt(1.0 + 4.0*q*r[2*n + j])) : r[2*n + j];
+            y[3*n + j]  = r[3*n + j];
+        }
+    }
+};
+
+//Quasi steady state reduction
+//--------------------------------------------------------------------------------
+//  Glycogen and extracellular fluid relax to the equilibria of dG = 0 and dECF = 0
+//
+//      G*   = sqrt(CI/kG)
+//      ECF* = ecfinit + (NAchange - zetaCI*(1 - CI/CIb))/zetaNa
+//
+//  in tauG = roG/(kG*(G + G*)) (about 1 day) and tauECF = Na/zetaNa (about 1 day)
+//  while lean and fat mass change over months. The reduced model uses G* and ECF*
+//  at each time (with dG = 0) and integrates only AT and L.
+//
+//  Error bound: after a single change of intake from row r to row r + 1 (jumps
+//  dG* and dECF* in G* and ECF*) the full and reduced models differ in body weight by
+//
+//      |BW - BW_qss| <= 3.7*|dG*|*exp(-t/tauG) + |dECF*|*exp(-t/tauECF) + (1 + F/10.4)*eL
+//
+//  where eL is the error in lean mass from using G* and ECF* in the energy balance
+//  during the transient and F/10.4 = dF/dL is the change of fat mass with lean mass:
+//
+//      eL <= C/(roL*|alfa1|)*(9.99*|(1 - betaTEF)*PAL - 1|*(3.7*|dG*|*tauG + |dECF*|*tauECF) + |dG*|)
+//
+//  With the constants of the model eL <= 5e-3*(3.7*|dG*| + |dECF*|) kg for PAL <= 2
+//  (e.g. -250 kcal from 2500 kcal with 50% carbohydrates moves G* by 0.03 kg and
+//  ECF* by 0.13 kg). The first two terms vanish a few days after the change but eL
+//  does not: lean mass relaxes over years so eL stays as an offset in L and F.
+//
+//  Varying intake: each change of row adds its own offset so, summed over the run,
+//
+//      |L - L_qss| <= 5e-3*sum_r (3.7*|dG*_r| + |dECF*_r|)
+//
+//  which grows with the total variation of G* and ECF* (e.g. intake that changes
+//  every day accumulates an error at each day; the bound is useful for intakes with
+//  a few step changes, not for noisy daily intakes).
+//  Without the fast states the time step is limited by tauAT = 14 days instead of
+//  tauG and tauECF so dt can be several days for long runs.
+class AdultQSSModel {
+public:
+    
+    static const int nstates = 2;
+    
+    AdultQSSModel(const AdultModel& input_full) : full(input_full) {}
+    
+    //Full model with parameters and inputs (outlives the solve, not copied)
+    const AdultModel& full;
+    
+    int size(void) const {
+        return full.size();
+    }
+    
+    void check(int nsteps) const {
+        full.check(nsteps);
+    }
+    
+    void initial(double* y, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            y[j]     = full.atinit[first + j];
+            y[n + j] = full.lean[first + j];
+        }
+    }
+    
+    //Quasi steady states at time t
+    inline double glycogen(int i, double t) const {
+        double CI = full.pcarb[i]*full.TotalIntake(i, t);
+        return std::sqrt(std::max(CI, 0.0)/full.kG[i]);
+    }
+    
+    inline double extracellular(int i, double t) const {
+        double CI = full.pcarb[i]*full.TotalIntake(i, t);
+        return full.ecfinit[i] + (full.NAchange(full.row(t), i) - full.zetaCI*(1.0 - CI/full.CIb[i]))/full.zetaNa;
+    }
+    
+    //Body weight of individual i (state j of block of n); baseline glycogen and
+    //extracellular fluid at t = 0
+    inline double bodyWeight(int i, double t, const double* y, int j, int n) const {
+        double L   = y[n + j];
+        double G   = (t > 0.0) ? glycogen(i, t) : full.G_base[i];
+        double ECF = (t > 0.0) ? extracellular(i, t) : full.ecfinit[i];
+        return full.fatMass(i, L) + L + ECF + 3.7*G;
+    }
+
+    //Outputs of individual i (as AdultModel::outputs)
+    static const int noutputs = AdultModel::noutputs;
+    inline void outputs(int i, double t, const double* y, int j, int n, double* v) const {
+        v[0] = y[j];
+        v[1] = (t > 0.0) ? extracellular(i, t) : full.ecfinit[i];
+        v[2] = (t > 0.0) ? glycogen(i, t) : full.G_base[i];
+        v[3] = y[n + j];
+        v[4] = full.fatMass(i, v[3]);
+        v[5] = v[4] + v[3] + v[1] + 3.7*v[2];
+        v[6] = v[5]/(full.ht[i]*full.ht[i]);
+        v[7] = (t > 0.0) ? full.TotalIntake(i, t) : full.EI[i];
+    }
+    
+    //Batch derivative kernel (AdultModel::derivatives with G = G*, ECF = ECF* and dG = 0)
+    void derivatives(double t, const double* y, double* dy, int first, int n) const {
+        const AdultModel& m = full;
+        int r = m.row(t);
+        for (int j = 0; j < n; j++){
+            int    i    = first + j;
+            double AT   = y[j];
+            double L    = y[n + j];
+            double dEI  = m.EIchange(r, i);
+            double TI   = m.EI[i] + dEI;
+            double F    = m.fatMass(i, L);
+            double rmr  = 9.99*(F + L + 3.7*glycogen(i, t) + extracellular(i, t)) + 625*m.ht[i] -
+                          4.92*(m.age[i] + t/365) + 5 - 166*m.sex[i];
+            double delta_times_bw = ((1 - m.betaTEF)*m.PAL(r, i) - 1)*rmr;
+            double R3   = m.K[i] + delta_times_bw + m.betaTEF*dEI + AT - TI;
+            double R    = (R3 + m.gammaL*L + m.gammaF*F)/(m.alfa1 + m.alfa2*F);
+            dy[j]       = (m.betaAT*dEI - AT)*(1.0/m.tauAT);
+            dy[n + j]   = R*(m.C/m.roL);
+        }
+    }
+    
+    //Stiff part: relaxation of AT
+    void implicitDerivatives(double t, const double* y, double* dy, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            dy[j]     = -y[j]/full.tauAT;
+            dy[n + j] = 0.0;
+        }
+    }
+    
+    //Analytic Jacobian for the Rosenbrock method (d f_k/d y_l at J[(2*k + l)*n + j])
+    void jacobian(double t, const double* y, double* J, int first, int n) const {
+        const AdultModel& m = full;
+        int r = m.row(t);
+        for (int j = 0; j < n; j++){
+            int    i    = first + j;
+            double AT   = y[j];
+            double L    = y[n + j];
+            double dEI  = m.EIchange(r, i);
+            double TI   = m.EI[i] + dEI;
+            double F    = m.fatMass(i, L);
+            double dF   = F*m.roL/(m.roF*m.C);
+            double rmr  = 9.99*(F + L + 3.7*glycogen(i, t) + extracellular(i, t)) + 625*m.ht[i] -
+                          4.92*(m.age[i] + t/365) + 5 - 166*m.sex[i];
+            double w    = (1 - m.betaTEF)*m.PAL(r, i) - 1;
+            double R3   = m.K[i] + w*rmr + m.betaTEF*dEI + AT - TI;
+            double D    = m.alfa1 + m.alfa2*F;
+            double R    = (R3 + m.gammaL*L + m.gammaF*F)/D;
+            J[j]        = -1.0/m.tauAT;
+            J[n + j]    = 0.0;
+            J[2*n + j]  = (m.C/m.roL)/D;
+            J[3*n + j]  = (m.C/m.roL)*((9.99*w*(dF + 1.0) + m.gammaL + m.gammaF*dF) - R*m.alfa2*dF)/D;
+        }
+    }
+    
+    void implicitSolve(double t, double a, const double* r, double* y, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            y[j]     = r[j]/(1.0 + a/full.tauAT);
+            y[n + j] = r[n + j];
+        }
+    }
+};
+
+#endif /* adult_model_h */
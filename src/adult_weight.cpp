@@ -63,52 +63,69 @@
 //----------------------------------------------------------------------------------------
 
 #include "adult_weight.h"
+#include "ode_engine.h"
+#include "regression.h"
+#include "bootstrap.h"
+#include "result_file.h"
+#include "window_sink.h"
+#include "dense_output_sink.h"
+#include "contrast.h"
+#include "alloc_report.h"
 
 //Default Constructor for an Adult.
 Adult::Adult(NumericVector weight, NumericVector height, NumericVector age_yrs,
-             NumericVector sexstring, NumericMatrix input_EIchange,
-             NumericMatrix input_NAchange, NumericMatrix physicalactivity,
-             NumericVector percentc, NumericVector percentb, double input_dt, bool checkValues){
+             NumericVector sexstring, InputMatrix input_EIchange,
+             InputMatrix input_NAchange, InputMatrix physicalactivity,
+             NumericVector percentc, NumericVector percentb, double input_dt, bool checkValues,
+             bool input_allocations, int nthreads){
+    
+    //Report allocations if requested
+    allocations = input_allocations;
     
     //Build model from parameters
     build(weight, height, age_yrs, sexstring, input_EIchange, input_NAchange,
-          physicalactivity, percentc, percentb, input_dt, checkValues);
+          physicalactivity, percentc, percentb, input_dt, checkValues, nthreads);
     
 }
 
 //Constructor with energy intake vector or fat vector
 Adult::Adult(NumericVector weight, NumericVector height, NumericVector age_yrs,
-             NumericVector sexstring, NumericMatrix input_EIchange,
-             NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+             NumericVector sexstring, InputMatrix input_EIchange,
+             InputMatrix input_NAchange, InputMatrix physicalactivity,
              NumericVector percentc, NumericVector percentb, double input_dt, NumericVector extradata,
-             bool checkValues, bool isEnergy){
+             bool checkValues, bool isEnergy, bool input_allocations, int nthreads){
     
+    //Report allocations if requested
+    allocations = input_allocations;
     
     //Build model from parameters
     build(weight, height, age_yrs, sexstring, input_EIchange, input_NAchange,
-          physicalactivity, percentc, percentb, input_dt, extradata, checkValues, isEnergy);
+          physicalactivity, percentc, percentb, input_dt, extradata, checkValues, isEnergy, nthreads);
     
 }
 
 //Constructor with energy intake vector and fat vector
 Adult::Adult(NumericVector weight, NumericVector height, NumericVector age_yrs,
-             NumericVector sexstring, NumericMatrix input_EIchange,
-             NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+             NumericVector sexstring, InputMatrix input_EIchange,
+             InputMatrix input_NAchange, InputMatrix physicalactivity,
              NumericVector percentc, NumericVector percentb, double input_dt, NumericVector input_EI,
-             NumericVector input_fat, bool checkValues){
+             NumericVector input_fat, bool checkValues, bool input_allocations, int nthreads){
     
+    //Report allocations if requested
+    allocations = input_allocations;
     
     //Build model from parameters
     build(weight, height, age_yrs, sexstring, input_EIchange, input_NAchange,
-          physicalactivity, percentc, percentb, input_dt ,input_EI, input_fat, checkValues);
+          physicalactivity, percentc, percentb, input_dt ,input_EI, input_fat, checkValues, nthreads);
     
 }
 
 //Function to build a new Adult
 void Adult::build(NumericVector weight, NumericVector height, NumericVector age_yrs,
-                  NumericVector sexstring, NumericMatrix input_EIchange,
-                  NumericMatrix input_NAchange, NumericMatrix physicalactivity,
-                  NumericVector percentc, NumericVector percentb, double input_dt, bool checkValues){
+                  NumericVector sexstring, InputMatrix input_EIchange,
+                  InputMatrix input_NAchange, InputMatrix physicalactivity,
+                  NumericVector percentc, NumericVector percentb, double input_dt, bool checkValues,
+                  int nthreads){
     
     //Assign parameters
     dt         = input_dt; //Time step set to 1 because of matrix use (each time is a row in EIchange)
@@ -123,25 +140,19 @@ void Adult::build(NumericVector weight, NumericVector height, NumericVector age_
     pcarb_base = percentb;
     check      = checkValues;
     
-    //Get energy
+    //Get energy and masses at baseline
+    hasEI  = false;
+    hasFat = false;
     getParameters();
-    getRMR();
-    getATinit();
-    getECFinit();
-    getBaselineMass();
-    getCaloricSteadyState();
-    getEnergy();
-   // getDelta(); //Check
-    getK();
-    getCarbConstants();
+    getBaseline(NULL, NULL, nthreads);
 }
 
 //Function to build a new Adult when input_EIintake and fat are included
 void Adult::build(NumericVector weight, NumericVector height, NumericVector age_yrs,
-                  NumericVector sexstring, NumericMatrix input_EIchange,
-                  NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+                  NumericVector sexstring, InputMatrix input_EIchange,
+                  InputMatrix input_NAchange, InputMatrix physicalactivity,
                   NumericVector percentc, NumericVector percentb, double input_dt,
-                  NumericVector extradata, bool checkValues, bool isEnergy){
+                  NumericVector extradata, bool checkValues, bool isEnergy, int nthreads){
     
     //Assign parameters
     dt         = input_dt; //For rk4
@@ -158,37 +169,29 @@ void Adult::build(NumericVector weight, NumericVector height, NumericVector age_
     
     //Get additional information
     getParameters();
-    getRMR();
-    getATinit();
-    getECFinit();
+    if (extradata.size() != nind){
+        stop("Dimension mismatch. EI and fat must have a value per individual.");
+    }
     
+    hasEI  = isEnergy;
+    hasFat = !isEnergy;
     if (isEnergy){
-        //Get energy
-        EI     = extradata;
-        
-        //Get bw
-        getBaselineMass();
+        //Inputted energy and masses at baseline
+        EI = extradata;
+        getBaseline(EI.begin(), NULL, nthreads);
     } else {
-        //Get energy
-        getCaloricSteadyState();
-        getEnergy();
-        
-        //Get bw
-        fat  = extradata;
-        lean = bw - (ecfinit + fat + 3.7*G_base);
+        //Inputted fat and energy at baseline
+        fat = extradata;
+        getBaseline(NULL, fat.begin(), nthreads);
     }
-    
-    //getDelta();
-    getK();
-    getCarbConstants();
 }
 
 //Function to build a new Adult when input_EIintake is included
 void Adult::build(NumericVector weight, NumericVector height, NumericVector age_yrs,
-                  NumericVector sexstring, NumericMatrix input_EIchange,
-                  NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+                  NumericVector sexstring, InputMatrix input_EIchange,
+                  InputMatrix input_NAchange, InputMatrix physicalactivity,
                   NumericVector percentc, NumericVector percentb, double input_dt,
-                  NumericVector input_EI, NumericVector input_fat, bool checkValues){
+                  NumericVector input_EI, NumericVector input_fat, bool checkValues, int nthreads){
     
     //Assign parameters
     dt         = input_dt; //For rk4
@@ -205,18 +208,16 @@ void Adult::build(NumericVector weight, NumericVector height, NumericVector age_
     
     //Get additional information
     getParameters();
-    getRMR();
-    getATinit();
-    getECFinit();
+    if (input_EI.size() != nind || input_fat.size() != nind){
+        stop("Dimension mismatch. EI and fat must have a value per individual.");
+    }
     
     //Inputted ei and fat
+    hasEI  = true;
+    hasFat = true;
     EI     = input_EI;
     fat    = input_fat;
-    lean    = bw - (ecfinit + fat + 3.7*G_base);
-
-    //getDelta();
-    getK();
-    getCarbConstants();
+    getBaseline(EI.begin(), fat.begin(), nthreads);
 }
 
 //Destroyer
@@ -248,12 +249,88 @@ void Adult::getParameters(void){
     C       = 10.4*(roL/roF);
     alfa1  = -(1 + etaL/roL)*C;     //Auxiliary functions from Pablo
     alfa2  = -(1 + etaF/roF);       //Auxiliary functions from Pablo
+}
+
+//Constants at baseline of every individual (resting metabolic rate by Mifflin &
+//St Jeor, extracellular fluid by Silva's equation, fat and lean mass, energy
+//intake at steady state, K and carbohydrate constants) in one pass over blocks of
+//individuals in nthreads threads (AdultModel::baseline). Energy intake and fat
+//mass are estimated when knownEI and knownfat are NULL.
+void Adult::getBaseline(const double* knownEI, const double* knownfat, int nthreads){
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    //Inputs
+    native.EIchange = EIchange.view();
+    native.NAchange = NAchange.view();
+    native.PAL      = PAL.view();
+    
+    //Constants
+    native.roG     = roG;
+    native.Na      = Na;
+    native.zetaNa  = zetaNa;
+    native.zetaCI  = zetaCI;
+    native.roF     = roF;
+    native.roL     = roL;
+    native.gammaF  = gammaF;
+    native.gammaL  = gammaL;
+    native.etaF    = etaF;
+    native.etaL    = etaL;
+    native.betaTEF = betaTEF;
+    native.betaAT  = betaAT;
+    native.tauAT   = tauAT;
+    native.C       = C;
+    native.alfa1   = alfa1;
+    native.alfa2   = alfa2;
+    native.dt      = dt;
+    
+    //Individuals and baseline in one pass without calls to R
+    AdultArrays   in    = {bw.begin(), ht.begin(), age.begin(), sex.begin(), pcarb_base.begin(),
+                           pcarb.begin(), knownEI, knownfat};
+    AdultModel&   model = native;
+    model.resizeBaseline(nind);
+    forBlocks(nind, nthreads, [&](int first, int n){
+        model.baseline(in, first, n);
+    });
+    setupSeconds = secondsSince(start);
+}
+
+//Constants at baseline of Adult::rk4 with the original vector operations (kept
+//apart from AdultModel::baseline so that the reference checks the native setup)
+void Adult::getLegacyBaseline(void){
+    
     rmrbw  = 9.99;        //Linear regression coefficient for rmr estimation
     rmrage = 4.92;        //Linear regression coefficient for rmr estimation
     rmrht  = 625.0;       //Linear regression coefficient for rmr estimation
     rmr_m  = 5.0;         //Linear regression coefficient for rmr estimation (men)
     rmr_f  = 161.0;       //Linear regression coefficient for rmr estimation (women)
     G_base = NumericVector(nind, 0.5);
+    
+    getRMR();
+    getATinit();
+    getECFinit();
+    
+    if (hasEI && hasFat){
+        //Inputted ei and fat
+        lean    = bw - (ecfinit + fat + 3.7*G_base);
+    } else if (hasEI){
+        //Get bw
+        getBaselineMass();
+    } else if (hasFat){
+        //Get energy
+        getCaloricSteadyState();
+        getEnergy();
+        
+        //Get bw
+        lean = bw - (ecfinit + fat + 3.7*G_base);
+    } else {
+        getBaselineMass();
+        getCaloricSteadyState();
+        getEnergy();
+    }
+    
+    getK();
+    getCarbConstants();
 }
 
 //Estimation of Resting Metabolic Rate (rmr) in kcal
@@ -268,7 +345,7 @@ void Adult::getRMR(void){
 void Adult::getCaloricSteadyState(void){
     //These estimation assumes Energy Intake = Energy Expenditure.
     //Energy is returned in kcal
-    steadystate = rmr*PAL(0,_);  //Check when running for the first tiem it might me PAL(_,0)
+    steadystate = rmr*PAL.row(0);  //Check when running for the first tiem it might me PAL(_,0)
 }
 
 void Adult::getATinit(void){
@@ -332,6 +409,7 @@ NumericVector Adult::dECF(double t, NumericVector ECF){
     return ( deltaNA(t) - zetaNa*(ECF - ecfinit) - zetaCI*(1.0 - CI(t)/CIb) )/Na;
 }
 
+
 //Carbohydrate constants
 void Adult::getCarbConstants(void){
     CIb = pcarb_base * EI;
@@ -358,7 +436,7 @@ void Adult::getK(){
      RMR is from the Mifflin-St Jeor equation. The physical activity pa- rameter, delta, at the baseline
      steady state is determined by equation 8 and therefore you can solve for K.
      */
-    K = (rmr * PAL(0,_)) - gammaL * lean - gammaF * fat - ((1.0 - betaTEF)*PAL(0,_) - 1.0)*rmr/bw * bw; //AQUI! Check when running for the first tiem it might me PAL(_,0)
+    K = (rmr * PAL.row(0)) - gammaL * lean - gammaF * fat - ((1.0 - betaTEF)*PAL.row(0) - 1.0)*rmr/bw * bw; //AQUI! Check when running for the first tiem it might me PAL(_,0)
 }
 
 //Get fat mass as function of lean tissue
@@ -405,24 +483,34 @@ StringVector Adult::BMIClassifier(NumericVector BMI){
         }
     }*/
     for(int i = 0; i < BMI.size(); i++){
-        classification(i) = "Unknown";
-        if (BMI(i) < 18.5){
-            classification(i) = "Underweight";
-        } else if (BMI(i) >= 18.5 && BMI(i) < 25){
-            classification(i) = "Normal";
-        } else if (BMI(i) >= 25 && BMI(i) < 30){
-            classification(i) = "Pre-Obese";
-        } else if (BMI(i) >= 30){
-            classification(i) = "Obese";
-        }
+        classification(i) = BMICategory(BMI(i));
     }
     return classification;
 }
 
+//Category of one BMI (written into the result by the native engine without
+//allocating a vector of categories for every output day)
+const char* Adult::BMICategory(double BMI){
+    if (BMI < 18.5){
+        return "Underweight";
+    } else if (BMI >= 18.5 && BMI < 25){
+        return "Normal";
+    } else if (BMI >= 25 && BMI < 30){
+        return "Pre-Obese";
+    } else if (BMI >= 30){
+        return "Obese";
+    }
+    return "Unknown";
+}
+
 
 //Rungue Kutta 4 method for Adult
+//Reference of every other method (method = "legacy"; see engine_compare in R): keep unchanged
 List Adult::rk4(double days){
     
+    //Constants at baseline for vector operations
+    getLegacyBaseline();
+    
     //Initial TIME(i-1)
     NumericVector k1, k2, k3, k4;
     
@@ -540,19 +628,305 @@ List Adult::rk4(double days){
 
 
 
+//Solve with native engine: method is one of "rk4", "rk45", "abm", "imex" or "rosenbrock"
+//and nthreads the number of threads (0 = all cores). If qss glycogen and
+//extracellular fluid are set to their quasi steady states (AdultQSSModel). If output
+//is a directory trajectories are written into result files in it (result_file.h)
+List Adult::solve(double days, std::string method, int nthreads, bool qss, std::string output){
+    
+    //Estimate number of elements to loop into
+    const int nsims = std::min(ceil(days/dt), EIchange.nrow() - 1.0);
+    
+    NumericMatrix AT  = resultMatrix(nind, nsims + 1, resultPath(output, "Adaptive_Thermogenesis"));
+    NumericMatrix ECF = resultMatrix(nind, nsims + 1, resultPath(output, "Extracellular_Fluid"));
+    NumericMatrix GLY = resultMatrix(nind, nsims + 1, resultPath(output, "Glycogen"));
+    NumericMatrix L   = resultMatrix(nind, nsims + 1, resultPath(output, "Lean_Mass"));
+    NumericMatrix F   = resultMatrix(nind, nsims + 1, resultPath(output, "Fat_Mass"));
+    NumericMatrix BW  = resultMatrix(nind, nsims + 1, resultPath(output, "Body_Weight"));
+    NumericMatrix BMI = resultMatrix(nind, nsims + 1, resultPath(output, "Body_Mass_Index"));
+    NumericMatrix TEI = resultMatrix(nind, nsims + 1, resultPath(output, "Energy_Intake"));
+    NumericMatrix AGE = resultMatrix(nind, nsims + 1, resultPath(output, "Age"));
+    StringMatrix CAT(nind, nsims + 1); //in rcpp
+    NumericVector TIME(nsims + 1); //in rcpp
+    
+    //Engine writes states directly into matrices
+    const AdultModel& model = nativeModel();
+    std::vector<double*> out;
+    out.push_back(AT.begin());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EngineStats stats;
+    if (qss){
+        out.push_back(L.begin());
+        DenseSink sink(out);
+        stats = solveModel(AdultQSSModel(model), dt, nsims, method, nthreads, sink);
+    } else {
+        out.push_back(ECF.begin());
+        out.push_back(GLY.begin());
+        out.push_back(L.begin());
+        DenseSink sink(out);
+        stats = solveModel(model, dt, nsims, method, nthreads, sink);
+    }
+    double integration = secondsSince(start);
+    
+    //Variables derived from states
+    AdultQSSModel reduced(model);
+    for (int i = 0; i <= nsims; i++){
+        TIME(i) = i*dt;
+        for (int j = 0; j < nind; j++){
+            if (qss){
+                ECF(j,i) = (i == 0) ? model.ecfinit[j] : reduced.extracellular(j, TIME(i));
+                GLY(j,i) = (i == 0) ? model.G_base[j] : reduced.glycogen(j, TIME(i));
+            }
+            F(j,i)   = model.fatMass(j, L(j,i));
+            BW(j,i)  = F(j,i) + L(j,i) + ECF(j,i) + 3.7*GLY(j,i);
+            BMI(j,i) = BW(j,i)/pow(ht(j), 2.0);
+            TEI(j,i) = (i == 0) ? model.EI[j] : model.TotalIntake(j, TIME(i));
+            AGE(j,i) = age(j) + TIME(i)/365.0;
+            CAT(j,i) = BMICategory(BMI(j,i));
+        }
+    }
+    
+    List out_list = List::create(Named("Time") = TIME,
+                                 Named("Age") = AGE,
+                                 Named("Adaptive_Thermogenesis") = AT,
+                                 Named("Extracellular_Fluid") = ECF,
+                                 Named("Glycogen") = GLY,
+                                 Named("Fat_Mass") = F,
+                                 Named("Lean_Mass")   = L,
+                                 Named("Body_Weight") = BW,
+                                 Named("Body_Mass_Index") = BMI,
+                                 Named("BMI_Category") = CAT,
+                                 Named("Energy_Intake") = TEI,
+                                 Named("Correct_Values")=stats.correct,
+                                 Named("Model_Type")="Adult");
+    
+    //Add allocations if requested
+    if (allocations){
+        out_list.push_back(allocationReport(stats, setupSeconds, integration), "Allocations");
+    }
+    
+    return out_list;
+}
+
+//Regression of weight change since baseline on covariates at output steps of
+//design (see regression.h) without keeping trajectories
+List Adult::regression(double days, std::string method, int nthreads, bool qss, List design){
+    
+    const int nsims = std::min(ceil(days/dt), EIchange.nrow() - 1.0);
+    
+    bool correct;
+    List sums;
+    const AdultModel& model = nativeModel();
+    if (qss){
+        sums = solveRegression(AdultQSSModel(model), dt, nsims, method, nthreads, design, correct);
+    } else {
+        sums = solveRegression(model, dt, nsims, method, nthreads, design, correct);
+    }
+    
+    return List::create(Named("Regression") = sums,
+                        Named("Correct_Values") = correct,
+                        Named("Model_Type") = "Adult");
+}
+
+//Poisson bootstrap of mean weight of groups at output steps of design (see
+//bootstrap.h) without keeping trajectories
+List Adult::bootstrap(double days, std::string method, int nthreads, bool qss, List design){
+    
+    const int nsims = std::min(ceil(days/dt), EIchange.nrow() - 1.0);
+    
+    bool correct;
+    List sums;
+    const AdultModel& model = nativeModel();
+    if (qss){
+        sums = solveBootstrap(AdultQSSModel(model), dt, nsims, method, nthreads, design, correct);
+    } else {
+        sums = solveBootstrap(model, dt, nsims, method, nthreads, design, correct);
+    }
+    
+    return List::create(Named("Bootstrap") = sums,
+                        Named("Correct_Values") = correct,
+                        Named("Model_Type") = "Adult");
+}
+
+//Paired difference of body weight between the scenario (second half of
+//individuals) and the baseline (first half) of groups at output steps of design
+//(see contrast.h) without keeping trajectories
+List Adult::contrast(double days, std::string method, int nthreads, bool qss, List design){
+    
+    const int nsims = std::min(ceil(days/dt), EIchange.nrow() - 1.0);
+    
+    bool correct;
+    List sums;
+    const AdultModel& model = nativeModel();
+    if (qss){
+        sums = solveContrast(AdultQSSModel(model), dt, nsims, method, nthreads, design, correct);
+    } else {
+        sums = solveContrast(model, dt, nsims, method, nthreads, design, correct);
+    }
+    
+    return List::create(Named("Contrast") = sums,
+                        Named("Correct_Values") = correct,
+                        Named("Model_Type") = "Adult");
+}
+
+//Outputs only at output steps of design (steps and width of windows), each one the
+//value at the step or its mean over the window of width steps that ends at it
+//(see window_sink.h) without keeping trajectories. Design may also ask for the
+//derivatives of outputs at output steps and for the outputs at queried
+//individuals and days (see dense_output_sink.h)
+List Adult::window(double days, std::string method, int nthreads, bool qss, std::string output, List design){
+    
+    const int nsims = std::min(ceil(days/dt), EIchange.nrow() - 1.0);
+    
+    IntegerVector steps = design["steps"];
+    int           width = as<int>(design["width"]);
+    int           ndays = steps.size();
+    for (int d = 0; d < ndays; d++){
+        if (steps[d] < 0 || steps[d] > nsims){
+            stop("Output days must be between 0 and the days of the model.");
+        }
+    }
+    if (width < 0){
+        stop("Invalid window. Please choose window >= 0.");
+    }
+    bool derivatives = design.containsElementNamed("derivatives") && as<bool>(design["derivatives"]);
+    if (derivatives && width > 0){
+        stop("Derivatives are only available for values at output days (window = 0).");
+    }
+    
+    //Names of outputs of native model (as in AdultModel::outputs)
+    const char* names[] = {"Adaptive_Thermogenesis", "Extracellular_Fluid", "Glycogen", "Lean_Mass",
+                           "Fat_Mass", "Body_Weight", "Body_Mass_Index", "Energy_Intake"};
+    
+    NumericMatrix AT  = resultMatrix(nind, ndays, resultPath(output, "Adaptive_Thermogenesis"));
+    NumericMatrix ECF = resultMatrix(nind, ndays, resultPath(output, "Extracellular_Fluid"));
+    NumericMatrix GLY = resultMatrix(nind, ndays, resultPath(output, "Glycogen"));
+    NumericMatrix L   = resultMatrix(nind, ndays, resultPath(output, "Lean_Mass"));
+    NumericMatrix F   = resultMatrix(nind, ndays, resultPath(output, "Fat_Mass"));
+    NumericMatrix BW  = resultMatrix(nind, ndays, resultPath(output, "Body_Weight"));
+    NumericMatrix BMI = resultMatrix(nind, ndays, resultPath(output, "Body_Mass_Index"));
+    NumericMatrix TEI = resultMatrix(nind, ndays, resultPath(output, "Energy_Intake"));
+    NumericMatrix AGE = resultMatrix(nind, ndays, resultPath(output, "Age"));
+    StringMatrix CAT(nind, ndays); //in rcpp
+    NumericVector TIME(ndays); //in rcpp
+    
+    //Engine accumulates outputs of steps of windows into matrices
+    const AdultModel& model = nativeModel();
+    std::vector<double*> out;
+    out.push_back(AT.begin());
+    out.push_back(ECF.begin());
+    out.push_back(GLY.begin());
+    out.push_back(L.begin());
+    out.push_back(F.begin());
+    out.push_back(BW.begin());
+    out.push_back(BMI.begin());
+    out.push_back(TEI.begin());
+    std::vector<int> outsteps(steps.begin(), steps.end());
+    
+    //Derivatives of outputs at output steps
+    List                 DER;
+    std::vector<double*> der;
+    if (derivatives){
+        for (int k = 0; k < AdultModel::noutputs; k++){
+            NumericMatrix D(nind, ndays);
+            DER.push_back(D, names[k]);
+            der.push_back(D.begin());
+        }
+    }
+    
+    //Outputs at queried individuals and days
+    IntegerVector        qind;
+    NumericVector        qday;
+    List                 QRY;
+    std::vector<double*> qry;
+    if (design.containsElementNamed("query")){
+        List query = design["query"];
+        qind = as<IntegerVector>(query["individual"]);
+        qday = as<NumericVector>(query["day"]);
+        if (qind.size() != qday.size()){
+            stop("Individuals and days of query must have the same length.");
+        }
+        for (int k = 0; k < AdultModel::noutputs; k++){
+            NumericVector Q(qday.size());
+            QRY.push_back(Q, names[k]);
+            qry.push_back(Q.begin());
+        }
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EngineStats stats;
+    if (qss){
+        AdultQSSModel reduced(model);
+        WindowSink<AdultQSSModel> window(reduced, out, outsteps, width);
+        DenseOutputSink<AdultQSSModel> sink(reduced, window, outsteps, dt);
+        sink.derivatives(der);
+        sink.queries(qind.begin(), qday.begin(), qday.size(), qry);
+        stats = solveModel(reduced, dt, nsims, method, nthreads, sink);
+    } else {
+        WindowSink<AdultModel> window(model, out, outsteps, width);
+        DenseOutputSink<AdultModel> sink(model, window, outsteps, dt);
+        sink.derivatives(der);
+        sink.queries(qind.begin(), qday.begin(), qday.size(), qry);
+        stats = solveModel(model, dt, nsims, method, nthreads, sink);
+    }
+    double integration = secondsSince(start);
+    
+    //Age is linear in time so its mean is at the middle of the window
+    for (int d = 0; d < ndays; d++){
+        TIME(d) = steps[d]*dt;
+        double middle = 0.5*(std::max(0, steps[d] - width) + steps[d])*dt;
+        for (int j = 0; j < nind; j++){
+            AGE(j,d) = age(j) + middle/365.0;
+            CAT(j,d) = BMICategory(BMI(j,d));
+        }
+    }
+    
+    List out_list = List::create(Named("Time") = TIME,
+                                 Named("Age") = AGE,
+                                 Named("Adaptive_Thermogenesis") = AT,
+                                 Named("Extracellular_Fluid") = ECF,
+                                 Named("Glycogen") = GLY,
+                                 Named("Fat_Mass") = F,
+                                 Named("Lean_Mass")   = L,
+                                 Named("Body_Weight") = BW,
+                                 Named("Body_Mass_Index") = BMI,
+                                 Named("BMI_Category") = CAT,
+                                 Named("Energy_Intake") = TEI,
+                                 Named("Correct_Values")=stats.correct,
+                                 Named("Model_Type")="Adult");
+    if (derivatives){
+        out_list.push_back(DER, "Derivatives");
+    }
+    if (design.containsElementNamed("query")){
+        out_list.push_back(QRY, "Query");
+    }
+    
+    //Add allocations if requested
+    if (allocations){
+        out_list.push_back(allocationReport(stats, setupSeconds, integration), "Allocations");
+    }
+    
+    return out_list;
+}
+
+//Native kernel built by getBaseline (individuals, inputs, constants and baseline)
+const AdultModel& Adult::nativeModel(void){
+    return native;
+}
+
 //Change in calories
 NumericVector Adult::deltaEI(double t){
-    return EIchange(floor(t/dt),_);
+    return EIchange.row(floor(t/dt));
 }
 
 //Change in sodiumxs
 NumericVector Adult::deltaNA(double t){
-    return NAchange(floor(t/dt),_);
+    return NAchange.row(floor(t/dt));
 }
 
 
 //Change in sodiumxs
 NumericVector Adult::deltaPAL(double t){
-    return PAL(floor(t/dt),_);
+    return PAL.row(floor(t/dt));
 }  // Check
 
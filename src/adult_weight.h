@@ -32,6 +32,8 @@
 
 #include <math.h>
 #include <Rcpp.h>
+#include "input_matrix.h"
+#include "adult_model.h"
 using namespace Rcpp;
 
 //Create a Adult class to contain individual parameters
@@ -41,23 +43,26 @@ public:
     
     //Constructor for when initial energy intake is estimated by the model
     Adult(NumericVector weight, NumericVector height, NumericVector age_yrs,
-          NumericVector sexstring, NumericMatrix input_EIchange,
-          NumericMatrix input_NAchange, NumericMatrix physicalactivity,
-          NumericVector percentc, NumericVector percentb, double dt, bool checkValues);
+          NumericVector sexstring, InputMatrix input_EIchange,
+          InputMatrix input_NAchange, InputMatrix physicalactivity,
+          NumericVector percentc, NumericVector percentb, double dt, bool checkValues,
+          bool input_allocations = false, int nthreads = 1);
     
     //Constructor for when initial energy or initial fat intake is added by user
     Adult(NumericVector weight, NumericVector height, NumericVector age_yrs,
-          NumericVector sexstring, NumericMatrix input_EIchange,
-          NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+          NumericVector sexstring, InputMatrix input_EIchange,
+          InputMatrix input_NAchange, InputMatrix physicalactivity,
           NumericVector percentc, NumericVector percentb, double dt,
-          NumericVector extradata, bool checkValues, bool isEnergy);
+          NumericVector extradata, bool checkValues, bool isEnergy,
+          bool input_allocations = false, int nthreads = 1);
     
     //Constructor for when initial energy intake and initial fat is added by user
     Adult(NumericVector weight, NumericVector height, NumericVector age_yrs,
-          NumericVector sexstring, NumericMatrix input_EIchange,
-          NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+          NumericVector sexstring, InputMatrix input_EIchange,
+          InputMatrix input_NAchange, InputMatrix physicalactivity,
           NumericVector percentc, NumericVector percentb, double dt,
-          NumericVector input_EI, NumericVector input_fat, bool checkValues);
+          NumericVector input_EI, NumericVector input_fat, bool checkValues,
+          bool input_allocations = false, int nthreads = 1);
     
     //Destroyer
     ~ Adult();
@@ -69,7 +74,7 @@ public:
     NumericVector age;             //Age (yrs)
     NumericVector sex;             //0 = "male"; 1 = "female"
     NumericVector EI;              //Energy intake (kcal)
-    NumericMatrix PAL;             //Physical Activity Level PAL
+    InputMatrix   PAL;             //Physical Activity Level PAL
     NumericVector fat;             //Fat mass at baseline (kg)
     NumericVector lean;            //Lean mass at baseline (kg)
     NumericVector steadystate;     //Steady state of energy intake for no weight change according to Miffin % St Jeor (kcal)
@@ -79,15 +84,25 @@ public:
     NumericVector pcarb;           //% carbohydrates after change
     NumericVector pcarb_base;      //% carbohydrates at baseline
     
-    //Numeric vectors containing EI and NA changes
-    NumericMatrix EIchange;
-    NumericMatrix NAchange;
+    //Matrices containing EI and NA changes (held by R or memory mapped)
+    InputMatrix EIchange;
+    InputMatrix NAchange;
+    
+    //Allocations and seconds of setup (reported if requested)
+    bool   allocations;
+    double setupSeconds;
     
 
     
     //Functions
     //---------------------------------------------------------------------------
     List rk4(double days); //in Rcpp:
+    List solve(double days, std::string method, int nthreads, bool qss = false, std::string output = ""); //Native engine (ode_engine.h)
+    List regression(double days, std::string method, int nthreads, bool qss, List design); //Regression of weight change (regression.h)
+    List bootstrap(double days, std::string method, int nthreads, bool qss, List design); //Bootstrap of mean weight (bootstrap.h)
+    List window(double days, std::string method, int nthreads, bool qss, std::string output, List design); //Output days and window means (window_sink.h)
+    List contrast(double days, std::string method, int nthreads, bool qss, List design); //Paired difference of scenario and baseline (contrast.h)
+    const AdultModel& nativeModel(void);
     
 private:
     
@@ -125,34 +140,42 @@ private:
     int    nind; //Number of individuals in model
     double dt;   //Delta t for Rungue Kutta 4
     bool check;
+    bool hasEI;  //Energy intake at baseline inputted
+    bool hasFat; //Fat mass at baseline inputted
+    
+    //Native kernel with the constants at baseline (built once by build)
+    AdultModel native;
     
     //Auxiliary functions
-    void getRMR(void);
     void getParameters(void);
+    void getBaseline(const double* knownEI, const double* knownfat, int nthreads);
+    void getLegacyBaseline(void);
+    void getRMR(void);
     void getBaselineMass(void);
     void getCaloricSteadyState(void);
     void getEnergy(void);
-    //void getDelta(void);
     void getK(void);
     void getCarbConstants(void);
     void getATinit(void);
     void getECFinit(void);
     void build(NumericVector weight, NumericVector height, NumericVector age_yrs,
-               NumericVector sexstring, NumericMatrix input_EIchange,
-               NumericMatrix input_NAchange, NumericMatrix physicalactivity,
-               NumericVector percentc, NumericVector percentb, double dt, bool checkValues);
+               NumericVector sexstring, InputMatrix input_EIchange,
+               InputMatrix input_NAchange, InputMatrix physicalactivity,
+               NumericVector percentc, NumericVector percentb, double dt, bool checkValues,
+               int nthreads);
     void build(NumericVector weight, NumericVector height, NumericVector age_yrs,
-               NumericVector sexstring, NumericMatrix input_EIchange,
-               NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+               NumericVector sexstring, InputMatrix input_EIchange,
+               InputMatrix input_NAchange, InputMatrix physicalactivity,
                NumericVector percentc, NumericVector percentb, double dt, NumericVector extradata,
-               bool checkValues, bool isEnergy);
+               bool checkValues, bool isEnergy, int nthreads);
     void build(NumericVector weight, NumericVector height, NumericVector age_yrs,
-               NumericVector sexstring, NumericMatrix input_EIchange,
-               NumericMatrix input_NAchange, NumericMatrix physicalactivity,
+               NumericVector sexstring, InputMatrix input_EIchange,
+               InputMatrix input_NAchange, InputMatrix physicalactivity,
                NumericVector percentc, NumericVector percentb, double dt, NumericVector input_EI,
-               NumericVector input_fat,bool checkValues);
+               NumericVector input_fat, bool checkValues, int nthreads);
     NumericVector TotalIntake (double t);
     StringVector  BMIClassifier(NumericVector BMI);
+    static const char* BMICategory(double BMI);
     NumericVector CI(double t);
     NumericVector R(double t, NumericVector L, NumericVector G,
                     NumericVector AT, NumericVector ECF);
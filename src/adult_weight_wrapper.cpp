@@ -21,6 +21,7 @@
 //  isEnergy        .-  Boolean to determine if energy intake at baseline is given
 //  input_EI        .-  Energy intake (kcal). 
 //  input_fat       .-  Fat Mass (kg) of the individual.
+//  output          .-  Directory of result files ("" to keep results in memory).
 //
 //  Authors:
 //  Dalia Camacho-García-Formentí
@@ -67,46 +68,100 @@
 
 // [[Rcpp::export]]
 List adult_weight_wrapper(NumericVector bw, NumericVector ht, NumericVector age,
-                          NumericVector sex, NumericMatrix EIchange,
-                          NumericMatrix NAchange, NumericMatrix PAL,
+                          NumericVector sex, SEXP EIchange,
+                          SEXP NAchange, SEXP PAL,
                           NumericVector pcarb_base, NumericVector pcarb, double dt,
-                          double days, bool checkValues){
+                          double days, bool checkValues, bool allocations,
+                          std::string method, int nthreads, bool qss,
+                          std::string output, SEXP regression, SEXP bootstrap, SEXP window,
+                          SEXP contrast){
     
     //Create new adult with characteristics
-    Adult Person (bw,  ht, age, sex, EIchange, NAchange, PAL, pcarb,  pcarb_base, dt, checkValues);
+    Adult Person (bw,  ht, age, sex, EIchange, NAchange, PAL, pcarb,  pcarb_base, dt, checkValues, allocations, nthreads);
     
-    //Run model using RK4
-    return Person.rk4(days);
+    //Run model using RK4 or native engine
+    if (!Rf_isNull(regression)){
+        return Person.regression(days, method, nthreads, qss, List(regression));
+    }
+    if (!Rf_isNull(bootstrap)){
+        return Person.bootstrap(days, method, nthreads, qss, List(bootstrap));
+    }
+    if (!Rf_isNull(contrast)){
+        return Person.contrast(days, method, nthreads, qss, List(contrast));
+    }
+    if (!Rf_isNull(window)){
+        return Person.window(days, method, nthreads, qss, output, List(window));
+    }
+    if (method == "legacy"){
+        return Person.rk4(days);
+    }
+    return Person.solve(days, method, nthreads, qss, output);
     
 }
 
 // [[Rcpp::export]]
 List adult_weight_wrapper_EI(NumericVector bw, NumericVector ht, NumericVector age,
-                          NumericVector sex, NumericMatrix EIchange,
-                          NumericMatrix NAchange, NumericMatrix PAL,
+                          NumericVector sex, SEXP EIchange,
+                          SEXP NAchange, SEXP PAL,
                           NumericVector pcarb_base, NumericVector pcarb, double dt,
-                             NumericVector extradata, double days, bool checkValues, bool isEnergy){
+                             NumericVector extradata, double days, bool checkValues, bool isEnergy,
+                             bool allocations, std::string method, int nthreads, bool qss,
+                          std::string output, SEXP regression, SEXP bootstrap, SEXP window,
+                          SEXP contrast){
     
     //Create new adult with characteristics
-    Adult Person (bw,  ht, age, sex, EIchange, NAchange, PAL, pcarb,  pcarb_base, dt, extradata, checkValues, isEnergy);
+    Adult Person (bw,  ht, age, sex, EIchange, NAchange, PAL, pcarb,  pcarb_base, dt, extradata, checkValues, isEnergy, allocations, nthreads);
     
-    //Run model using RK4
-    return Person.rk4(days);
+    //Run model using RK4 or native engine
+    if (!Rf_isNull(regression)){
+        return Person.regression(days, method, nthreads, qss, List(regression));
+    }
+    if (!Rf_isNull(bootstrap)){
+        return Person.bootstrap(days, method, nthreads, qss, List(bootstrap));
+    }
+    if (!Rf_isNull(contrast)){
+        return Person.contrast(days, method, nthreads, qss, List(contrast));
+    }
+    if (!Rf_isNull(window)){
+        return Person.window(days, method, nthreads, qss, output, List(window));
+    }
+    if (method == "legacy"){
+        return Person.rk4(days);
+    }
+    return Person.solve(days, method, nthreads, qss, output);
     
 }
 
 // [[Rcpp::export]]
 List adult_weight_wrapper_EI_fat(NumericVector bw, NumericVector ht, NumericVector age,
-                             NumericVector sex, NumericMatrix EIchange,
-                             NumericMatrix NAchange, NumericMatrix PAL,
+                             NumericVector sex, SEXP EIchange,
+                             SEXP NAchange, SEXP PAL,
                              NumericVector pcarb_base, NumericVector pcarb, double dt,
                              NumericVector input_EI, NumericVector input_fat,
-                                 double days, bool checkValues){
+                                 double days, bool checkValues, bool allocations,
+                                 std::string method, int nthreads, bool qss,
+                          std::string output, SEXP regression, SEXP bootstrap, SEXP window,
+                          SEXP contrast){
     
     //Create new adult with characteristics
-    Adult Person (bw,  ht, age, sex, EIchange, NAchange, PAL, pcarb,  pcarb_base, dt, input_EI, input_fat, checkValues);
+    Adult Person (bw,  ht, age, sex, EIchange, NAchange, PAL, pcarb,  pcarb_base, dt, input_EI, input_fat, checkValues, allocations, nthreads);
     
-    //Run model using RK4
-    return Person.rk4(days);
+    //Run model using RK4 or native engine
+    if (!Rf_isNull(regression)){
+        return Person.regression(days, method, nthreads, qss, List(regression));
+    }
+    if (!Rf_isNull(bootstrap)){
+        return Person.bootstrap(days, method, nthreads, qss, List(bootstrap));
+    }
+    if (!Rf_isNull(contrast)){
+        return Person.contrast(days, method, nthreads, qss, List(contrast));
+    }
+    if (!Rf_isNull(window)){
+        return Person.window(days, method, nthreads, qss, output, List(window));
+    }
+    if (method == "legacy"){
+        return Person.rk4(days);
+    }
+    return Person.solve(days, method, nthreads, qss, output);
     
 }
@@ -0,0 +1,102 @@
+//
+//  aligned_vector.h
+//
+//  This is a function that defines a vector of doubles whose first element is
+//  aligned to a cache line (64 bytes). The native kernels keep a vector per
+//  constant of the individuals (structure of arrays) which are read in loops
+//  over blocks of individuals; with aligned vectors every block of a multiple
+//  of 8 individuals starts at a cache line and the loops can use aligned
+//  vector loads. Resizing does not zero the elements so that large vectors are
+//  first written by the (parallel) loops that fill them. R does not call this
+//  allocator so it can be used in worker threads.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef aligned_vector_h
+#define aligned_vector_h
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+//Allocator of blocks aligned to Alignment bytes (the offset to the block returned
+//by malloc is kept in the byte before the aligned block)
+//--------------------------------------------------------------------------------
+template <class T, size_t Alignment = 64>
+class AlignedAllocator {
+public:
+
+    typedef T value_type;
+
+    template <class U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator(void) {}
+
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n){
+        char* block = (char*) std::malloc(n*sizeof(T) + Alignment);
+        if (block == NULL) throw std::bad_alloc();
+        size_t offset = Alignment - ((size_t) block) % Alignment;
+        block[offset - 1] = (char) offset;
+        return (T*) (block + offset);
+    }
+
+    //Elements are not zeroed when a vector is resized (they are written by the
+    //loops that fill them, in the threads that use them)
+    template <class U>
+    void construct(U* p){
+        ::new((void*) p) U;
+    }
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args){
+        ::new((void*) p) U(std::forward<Args>(args)...);
+    }
+
+    void deallocate(T* p, size_t){
+        char* aligned = (char*) p;
+        std::free(aligned - (unsigned char) aligned[-1]);
+    }
+};
+
+template <class T, class U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&){
+    return true;
+}
+
+template <class T, class U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&){
+    return false;
+}
+
+typedef std::vector<double, AlignedAllocator<double> > AlignedVector;
+
+#endif /* aligned_vector_h */
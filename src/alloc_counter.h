@@ -0,0 +1,98 @@
+//
+//  alloc_counter.h
+//
+//  This is a function that defines an allocator which counts the blocks it
+//  allocates (and their bytes) in the thread that calls it. The work vectors
+//  of the native engine (ode_engine.h, ode_integrators.h and the buffers of
+//  each block of the sinks) are WorkVectors so that the engine measures the
+//  allocations of the setup of each block and of each time step (EngineStats)
+//  and a step that allocates shows up in the counts. R does not call this
+//  allocator so it can be used in worker threads.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef alloc_counter_h
+#define alloc_counter_h
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+//Blocks and bytes allocated by CountingAllocator in the calling thread (read
+//before and after the work to measure)
+//--------------------------------------------------------------------------------
+struct AllocTally {
+    double count;
+    double bytes;
+};
+
+inline AllocTally& allocTally(void){
+    static thread_local AllocTally tally = {0.0, 0.0};
+    return tally;
+}
+
+//Allocator of blocks counted in the tally of the calling thread
+//--------------------------------------------------------------------------------
+template <class T>
+class CountingAllocator {
+public:
+
+    typedef T value_type;
+
+    template <class U>
+    struct rebind {
+        typedef CountingAllocator<U> other;
+    };
+
+    CountingAllocator(void) {}
+
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n){
+        AllocTally& tally = allocTally();
+        tally.count += 1.0;
+        tally.bytes += ((double) n)*sizeof(T);
+        return (T*) ::operator new(n*sizeof(T));
+    }
+
+    void deallocate(T* p, size_t){
+        ::operator delete(p);
+    }
+};
+
+template <class T, class U>
+bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&){
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&){
+    return false;
+}
+
+typedef std::vector<double, CountingAllocator<double> > WorkVector;
+typedef std::vector<int, CountingAllocator<int> >       WorkIndex;
+
+#endif /* alloc_counter_h */
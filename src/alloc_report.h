@@ -0,0 +1,62 @@
+//
+//  alloc_report.h
+//
+//  This is a function that defines the Allocations list of the native engine
+//  (Adult::solve, Adult::window and Child::solve) when allocations = TRUE. The
+//  counts are measured by the engine with the counting allocator of
+//  alloc_counter.h (EngineStats): the setup of the blocks (workspace and sinks)
+//  and each time step. Seconds are the wall time of the setup of the model
+//  (constants at baseline) and of the integration.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef alloc_report_h
+#define alloc_report_h
+
+#include <chrono>
+#include <Rcpp.h>
+#include "ode_engine.h"
+using namespace Rcpp;
+
+//Seconds elapsed since start
+inline double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Allocations by phase (setup of blocks and all steps) and by step
+inline List allocationReport(const EngineStats& stats, double setup, double integration){
+    double count = 0.0, bytes = 0.0;
+    for (size_t s = 0; s < stats.stepCount.size(); s++){
+        count += stats.stepCount[s];
+        bytes += stats.stepBytes[s];
+    }
+    return List::create(Named("Phase") = CharacterVector::create("setup", "steps"),
+                        Named("Count") = NumericVector::create(stats.setupCount, count),
+                        Named("Bytes") = NumericVector::create(stats.setupBytes, bytes),
+                        Named("Seconds") = NumericVector::create(setup, integration),
+                        Named("Step_Count") = NumericVector(stats.stepCount.begin(), stats.stepCount.end()),
+                        Named("Step_Bytes") = NumericVector(stats.stepBytes.begin(), stats.stepBytes.end()));
+}
+
+#endif /* alloc_report_h */
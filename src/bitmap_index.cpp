@@ -0,0 +1,97 @@
+//
+//  bitmap_index.cpp
+//
+//  This is a function that passes the compressed bitmaps of subsets of a
+//  population (bitmap_index.h) to and from R where they are raw vectors of
+//  the compressed words.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <Rcpp.h>
+#include "bitmap_index.h"
+using namespace Rcpp;
+
+//Bitmap of population of nbits individuals from its words in R
+Bitmap bitmapFromR(RawVector words, double nbits){
+    Bitmap bitmap((uint64_t) nbits);
+    bitmap.words.resize(words.size()/sizeof(uint64_t));
+    if (!bitmap.words.empty()){
+        std::memcpy(&bitmap.words[0], words.begin(), bitmap.words.size()*sizeof(uint64_t));
+    }
+    return bitmap;
+}
+
+RawVector bitmapToR(const Bitmap& bitmap){
+    RawVector words(bitmap.words.size()*sizeof(uint64_t));
+    if (!bitmap.words.empty()){
+        std::memcpy(words.begin(), &bitmap.words[0], bitmap.words.size()*sizeof(uint64_t));
+    }
+    return words;
+}
+
+//Bitmaps of every level of a column (codes 0, ..., nlevels - 1; NA as -1)
+// [[Rcpp::export]]
+List bitmap_column_wrapper(IntegerVector codes, int nlevels){
+    std::vector<Bitmap> bitmaps = bitmapColumn(codes.begin(), codes.size(), nlevels);
+    List out(nlevels);
+    for (int l = 0; l < nlevels; l++){
+        out[l] = bitmapToR(bitmaps[l]);
+    }
+    return out;
+}
+
+//Set operation ("and", "or" or "not" of x) of subsets
+// [[Rcpp::export]]
+RawVector bitmap_combine_wrapper(RawVector x, RawVector y, double n, std::string op){
+    Bitmap a = bitmapFromR(x, n);
+    if (op == "not"){
+        return bitmapToR(bitmapNot(a));
+    }
+    Bitmap b = bitmapFromR(y, n);
+    if (op == "and"){
+        return bitmapToR(bitmapCombine(a, b, BitmapAnd()));
+    } else if (op == "or"){
+        return bitmapToR(bitmapCombine(a, b, BitmapOr()));
+    }
+    stop("Invalid operation of subsets.");
+    return x;
+}
+
+//Rows (from 1) of individuals in subset
+// [[Rcpp::export]]
+IntegerVector bitmap_rows_wrapper(RawVector x, double n){
+    std::vector<int> rows = bitmapRows(bitmapFromR(x, n));
+    IntegerVector out(rows.size());
+    for (size_t k = 0; k < rows.size(); k++){
+        out[k] = rows[k] + 1;
+    }
+    return out;
+}
+
+//Individuals in subset
+// [[Rcpp::export]]
+double bitmap_count_wrapper(RawVector x, double n){
+    return bitmapCount(bitmapFromR(x, n));
+}
@@ -0,0 +1,406 @@
+//
+//  bitmap_index.h
+//
+//  This is a function that defines compressed bitmaps of subsets of a
+//  population (e.g. the individuals with a level of sex, bmiCat or a group
+//  id) so that runs and aggregations target boolean combinations of subsets
+//  without copying inputs. It does not depend on R.
+//
+//  Variables:
+//  nbits           .-  Individuals of the population
+//  words           .-  Compressed words of the bitmap
+//
+//  Bits are packed in 64 bit words compressed as in EWAH (Lemire et al, 2010):
+//  a marker word holds a run of words that are all 0 or all 1 (fill) and the
+//  number of literal words that follow it. Populations sorted by a column
+//  have long fills while others keep one bit per individual. Set operations
+//  skip fills and combine literal words with loops over words (vectorized
+//  by the compiler) so they take time proportional to the compressed size.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef bitmap_index_h
+#define bitmap_index_h
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+
+//Marker word: bit 0 fill bit, bits 1-32 fill words, bits 33-63 literal words
+#define BITMAP_FILL_MAX    ((uint64_t) 0xFFFFFFFFULL)
+#define BITMAP_LITERAL_MAX ((uint64_t) 0x7FFFFFFFULL)
+#define BITMAP_ONES        ((uint64_t) 0xFFFFFFFFFFFFFFFFULL)
+
+inline bool     bitmapFillBit(uint64_t marker){ return (marker & 1ULL) != 0; }
+inline uint64_t bitmapFills(uint64_t marker){ return (marker >> 1) & BITMAP_FILL_MAX; }
+inline uint64_t bitmapLiterals(uint64_t marker){ return marker >> 33; }
+inline uint64_t bitmapMarker(bool bit, uint64_t fills, uint64_t literals){
+    return (bit ? 1ULL : 0ULL) | (fills << 1) | (literals << 33);
+}
+
+//Bits set in word and position of lowest bit set
+inline int bitmapPopcount(uint64_t w){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(w);
+#else
+    int count = 0;
+    for (; w != 0; w &= w - 1) count++;
+    return count;
+#endif
+}
+
+inline int bitmapLowest(uint64_t w){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(w);
+#else
+    int k = 0;
+    for (; (w & 1ULL) == 0; w >>= 1) k++;
+    return k;
+#endif
+}
+
+//Compressed bitmap of nbits individuals
+//--------------------------------------------------------------------------------
+struct Bitmap {
+
+    uint64_t              nbits;
+    std::vector<uint64_t> words;
+
+    Bitmap(void){
+        nbits = 0;
+    }
+
+    explicit Bitmap(uint64_t input_nbits){
+        nbits = input_nbits;
+    }
+
+    //Uncompressed words of the bitmap
+    uint64_t size(void) const {
+        return (nbits + 63)/64;
+    }
+};
+
+//Appends uncompressed words to a bitmap
+//--------------------------------------------------------------------------------
+class BitmapWriter {
+public:
+
+    BitmapWriter(Bitmap& input_bitmap) : bitmap(input_bitmap) {
+        bitmap.words.clear();
+        marker = 0;
+    }
+
+    //n words all 0 or all 1
+    void fill(bool bit, uint64_t n){
+        while (n > 0){
+            uint64_t m = (marker < bitmap.words.size()) ? bitmap.words[marker] : 0;
+            bool open  = marker < bitmap.words.size() && bitmapLiterals(m) == 0 &&
+                (bitmapFills(m) == 0 || bitmapFillBit(m) == bit) && bitmapFills(m) < BITMAP_FILL_MAX;
+            if (!open){
+                newMarker();
+                continue;
+            }
+            uint64_t k = std::min(n, BITMAP_FILL_MAX - bitmapFills(m));
+            bitmap.words[marker] = bitmapMarker(bit, bitmapFills(m) + k, 0);
+            n -= k;
+        }
+    }
+
+    void literal(uint64_t w){
+        if (w == 0){
+            fill(false, 1);
+        } else if (w == BITMAP_ONES){
+            fill(true, 1);
+        } else {
+            if (marker >= bitmap.words.size() || bitmapLiterals(bitmap.words[marker]) == BITMAP_LITERAL_MAX){
+                newMarker();
+            }
+            uint64_t m = bitmap.words[marker];
+            bitmap.words[marker] = bitmapMarker(bitmapFillBit(m), bitmapFills(m), bitmapLiterals(m) + 1);
+            bitmap.words.push_back(w);
+        }
+    }
+
+    void literals(const uint64_t* w, uint64_t n){
+        for (uint64_t k = 0; k < n; k++) literal(w[k]);
+    }
+
+private:
+
+    Bitmap& bitmap;
+    size_t  marker; //Position of last marker (words.size() if none)
+
+    void newMarker(void){
+        marker = bitmap.words.size();
+        bitmap.words.push_back(bitmapMarker(false, 0, 0));
+    }
+};
+
+//Reads runs of a bitmap: fills words all equal to bit or nliterals literal words
+//--------------------------------------------------------------------------------
+class BitmapCursor {
+public:
+
+    uint64_t        fills;
+    bool            bit;
+    uint64_t        nliterals;
+    const uint64_t* literals;
+
+    BitmapCursor(const Bitmap& bitmap){
+        words     = bitmap.words.empty() ? NULL : &bitmap.words[0];
+        position  = 0;
+        end       = bitmap.words.size();
+        fills     = 0;
+        bit       = false;
+        nliterals = 0;
+        literals  = NULL;
+        next();
+    }
+
+    bool done(void) const {
+        return fills == 0 && nliterals == 0;
+    }
+
+    void skipFills(uint64_t n){
+        fills -= n;
+        next();
+    }
+
+    void skipLiterals(uint64_t n){
+        literals  += n;
+        nliterals -= n;
+        next();
+    }
+
+private:
+
+    const uint64_t* words;
+    size_t          position;
+    size_t          end;
+
+    void next(void){
+        while (fills == 0 && nliterals == 0 && position < end){
+            uint64_t m = words[position++];
+            bit        = bitmapFillBit(m);
+            fills      = bitmapFills(m);
+            nliterals  = bitmapLiterals(m);
+            literals   = words + position;
+            position  += nliterals;
+        }
+    }
+};
+
+//Word operations of sets
+//--------------------------------------------------------------------------------
+struct BitmapAnd {
+    inline uint64_t operator()(uint64_t x, uint64_t y) const { return x & y; }
+};
+
+struct BitmapOr {
+    inline uint64_t operator()(uint64_t x, uint64_t y) const { return x | y; }
+};
+
+struct BitmapAndNot {
+    inline uint64_t operator()(uint64_t x, uint64_t y) const { return x & ~y; }
+};
+
+//Combination of bitmaps of the same population word by word
+//--------------------------------------------------------------------------------
+template <class Op>
+Bitmap bitmapCombine(const Bitmap& a, const Bitmap& b, Op op){
+
+    if (a.nbits != b.nbits){
+        throw std::invalid_argument("Subsets must be of the same population.");
+    }
+
+    Bitmap out(a.nbits);
+    BitmapWriter writer(out);
+    BitmapCursor x(a);
+    BitmapCursor y(b);
+    std::vector<uint64_t> buffer;
+
+    while (!x.done() && !y.done()){
+        if (x.fills > 0 && y.fills > 0){
+            uint64_t n = std::min(x.fills, y.fills);
+            writer.fill(op(x.bit ? BITMAP_ONES : 0, y.bit ? BITMAP_ONES : 0) != 0, n);
+            x.skipFills(n);
+            y.skipFills(n);
+        } else if (x.fills > 0){
+            uint64_t n  = std::min(x.fills, y.nliterals);
+            uint64_t fw = x.bit ? BITMAP_ONES : 0;
+            buffer.resize(n);
+            for (uint64_t k = 0; k < n; k++) buffer[k] = op(fw, y.literals[k]);
+            writer.literals(&buffer[0], n);
+            x.skipFills(n);
+            y.skipLiterals(n);
+        } else if (y.fills > 0){
+            uint64_t n  = std::min(x.nliterals, y.fills);
+            uint64_t fw = y.bit ? BITMAP_ONES : 0;
+            buffer.resize(n);
+            for (uint64_t k = 0; k < n; k++) buffer[k] = op(x.literals[k], fw);
+            writer.literals(&buffer[0], n);
+            x.skipLiterals(n);
+            y.skipFills(n);
+        } else {
+            uint64_t n = std::min(x.nliterals, y.nliterals);
+            buffer.resize(n);
+            for (uint64_t k = 0; k < n; k++) buffer[k] = op(x.literals[k], y.literals[k]);
+            writer.literals(&buffer[0], n);
+            x.skipLiterals(n);
+            y.skipLiterals(n);
+        }
+    }
+
+    return out;
+}
+
+//Bitmap with every individual of the population
+inline Bitmap bitmapAll(uint64_t nbits){
+    Bitmap out(nbits);
+    BitmapWriter writer(out);
+    writer.fill(true, nbits/64);
+    if (nbits % 64 != 0){
+        writer.literal((1ULL << (nbits % 64)) - 1);
+    }
+    return out;
+}
+
+//Individuals not in bitmap
+inline Bitmap bitmapNot(const Bitmap& a){
+    return bitmapCombine(bitmapAll(a.nbits), a, BitmapAndNot());
+}
+
+//Number of individuals in bitmap
+inline double bitmapCount(const Bitmap& a){
+    double count = 0.0;
+    for (BitmapCursor x(a); !x.done(); ){
+        if (x.fills > 0){
+            count += x.bit ? 64.0*x.fills : 0.0;
+            x.skipFills(x.fills);
+        } else {
+            for (uint64_t k = 0; k < x.nliterals; k++) count += bitmapPopcount(x.literals[k]);
+            x.skipLiterals(x.nliterals);
+        }
+    }
+    return count;
+}
+
+//Individuals (0, ..., nbits - 1) in bitmap in increasing order
+inline std::vector<int> bitmapRows(const Bitmap& a){
+    std::vector<int> rows;
+    rows.reserve((size_t) bitmapCount(a));
+    uint64_t word = 0;
+    for (BitmapCursor x(a); !x.done(); ){
+        if (x.fills > 0){
+            if (x.bit){
+                for (uint64_t k = 64*word; k < 64*(word + x.fills); k++) rows.push_back((int) k);
+            }
+            word += x.fills;
+            x.skipFills(x.fills);
+        } else {
+            for (uint64_t k = 0; k < x.nliterals; k++, word++){
+                for (uint64_t w = x.literals[k]; w != 0; w &= w - 1){
+                    rows.push_back((int) (64*word + bitmapLowest(w)));
+                }
+            }
+            x.skipLiterals(x.nliterals);
+        }
+    }
+    return rows;
+}
+
+//Bitmaps of every level of a categorical column with codes 0, ..., nlevels - 1
+//(negative codes are missing values and belong to no level) in one pass
+inline std::vector<Bitmap> bitmapColumn(const int* codes, uint64_t n, int nlevels){
+
+    std::vector<Bitmap>       bitmaps(nlevels, Bitmap(n));
+    std::vector<BitmapWriter> writers;
+    std::vector<uint64_t>     current(nlevels, 0);   //Word being filled
+    std::vector<uint64_t>     written(nlevels, 0);   //Words written
+    writers.reserve(nlevels);
+    for (int l = 0; l < nlevels; l++){
+        writers.push_back(BitmapWriter(bitmaps[l]));
+    }
+
+    uint64_t nwords = (n + 63)/64;
+    for (uint64_t word = 0; word < nwords; word++){
+
+        //Bits of the word in levels it touches
+        uint64_t last = std::min(n, 64*(word + 1));
+        for (uint64_t i = 64*word; i < last; i++){
+            int code = codes[i];
+            if (code >= nlevels){
+                throw std::invalid_argument("Invalid level of column.");
+            }
+            if (code >= 0) current[code] |= 1ULL << (i - 64*word);
+        }
+
+        //Levels with bits are written after zero fills since their last word
+        for (uint64_t i = 64*word; i < last; i++){
+            int code = codes[i];
+            if (code < 0 || current[code] == 0) continue;
+            writers[code].fill(false, word - written[code]);
+            writers[code].literal(current[code]);
+            written[code] = word + 1;
+            current[code] = 0;
+        }
+    }
+
+    for (int l = 0; l < nlevels; l++){
+        writers[l].fill(false, nwords - written[l]);
+    }
+
+    return bitmaps;
+}
+
+//Groups of the individuals of a run (rows of population, -1 if none) as
+//members[start[j]], ..., members[start[j + 1] - 1] of individual j of run
+inline void bitmapMembers(const std::vector<Bitmap>& groups, const std::vector<int>& position,
+                          int nrun, std::vector<int>& start, std::vector<int>& members){
+
+    std::vector<std::vector<int> > rows(groups.size());
+    start.assign(nrun + 1, 0);
+    for (size_t g = 0; g < groups.size(); g++){
+        rows[g] = bitmapRows(groups[g]);
+        for (size_t k = 0; k < rows[g].size(); k++){
+            int j = position[rows[g][k]];
+            if (j >= 0) start[j + 1]++;
+        }
+    }
+    for (int j = 0; j < nrun; j++){
+        start[j + 1] += start[j];
+    }
+
+    std::vector<int> next(start.begin(), start.end() - 1);
+    members.resize(start[nrun]);
+    for (size_t g = 0; g < groups.size(); g++){
+        for (size_t k = 0; k < rows[g].size(); k++){
+            int j = position[rows[g][k]];
+            if (j >= 0) members[next[j]++] = g;
+        }
+    }
+}
+
+#endif /* bitmap_index_h */
@@ -0,0 +1,133 @@
+//
+//  bootstrap.h
+//
+//  This is a function that runs a model in the native engine with a
+//  BootstrapSink (bootstrap_sink.h) and returns its sums to R. Used by
+//  Child::bootstrap and Adult::bootstrap.
+//
+//  Variables:
+//  design          .-  List with groups (0, ..., ngroups - 1), number of groups,
+//                      weights, ids, replicates, seed and output steps. Groups
+//                      may instead be subsets (bitmaps of bitmap_index.h of a
+//                      population of n individuals) with the rows of the
+//                      population that run in the model
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef bootstrap_h
+#define bootstrap_h
+
+#include <Rcpp.h>
+#include "ode_engine.h"
+#include "bootstrap_sink.h"
+#include "bitmap_index.h"
+using namespace Rcpp;
+
+//Bitmap of subset of population of nbits individuals (bitmap_index.cpp)
+Bitmap bitmapFromR(RawVector words, double nbits);
+
+template <class Model>
+List solveBootstrap(const Model& model, double dt, int nsims, std::string method,
+                    int nthreads, List design, bool& correct){
+    
+    NumericVector weights = design["weights"];
+    NumericVector ids     = design["ids"];
+    IntegerVector steps   = design["steps"];
+    int           ngroups = as<int>(design["ngroups"]);
+    int           B       = as<int>(design["replicates"]);
+    double        seed    = as<double>(design["seed"]);
+    
+    //Check design
+    if (weights.size() != model.size() || ids.size() != model.size()){
+        stop("Weights and ids of bootstrap must have one value per individual.");
+    }
+    
+    //Either a group per individual or the groups of each individual (subsets)
+    IntegerVector    group;
+    std::vector<int> start;
+    std::vector<int> members;
+    if (design.containsElementNamed("subsets")){
+        List          subsets = design["subsets"];
+        IntegerVector rows    = design["rows"];
+        double        n       = as<double>(design["n"]);
+        if (rows.size() != model.size()){
+            stop("Rows of bootstrap must have one value per individual.");
+        }
+        std::vector<int> position((size_t) n, -1);
+        for (int j = 0; j < rows.size(); j++){
+            if (rows[j] < 0 || rows[j] >= n){
+                stop("Invalid rows of bootstrap.");
+            }
+            position[rows[j]] = j;
+        }
+        std::vector<Bitmap> groups;
+        for (int g = 0; g < subsets.size(); g++){
+            groups.push_back(bitmapFromR(subsets[g], n));
+        }
+        bitmapMembers(groups, position, model.size(), start, members);
+        group = IntegerVector(members.begin(), members.end());
+    } else {
+        group = design["group"];
+        if (group.size() != model.size()){
+            stop("Groups of bootstrap must have one value per individual.");
+        }
+    }
+    for (int i = 0; i < group.size(); i++){
+        if (group[i] < 0 || group[i] >= ngroups){
+            stop("Invalid group of bootstrap.");
+        }
+    }
+    for (int d = 0; d < steps.size(); d++){
+        if (steps[d] < 0 || steps[d] > nsims){
+            stop("Bootstrap days must be between 0 and the days of the model.");
+        }
+    }
+    if (B < 1){
+        stop("Invalid number of bootstrap replicates. Please choose replicates >= 1.");
+    }
+    
+    //Run without keeping trajectories
+    BootstrapSink<Model> sink(model, group.begin(), weights.begin(), ids.begin(), ngroups, B, seed,
+                              std::vector<int>(steps.begin(), steps.end()),
+                              start.empty() ? NULL : &start[0]);
+    EngineStats stats = solveModel(model, dt, nsims, method, nthreads, sink);
+    correct = stats.correct;
+    
+    //Sums as R arrays (by column)
+    const BootstrapSums& sums = sink.sums;
+    NumericVector W(sums.W.begin(), sums.W.end());
+    NumericMatrix S(sums.ngroups, sums.ndays);
+    NumericMatrix WB(sums.B, sums.ngroups);
+    NumericVector SB(sums.SB.begin(), sums.SB.end());
+    std::copy(sums.S.begin(), sums.S.end(), S.begin());
+    std::copy(sums.WB.begin(), sums.WB.end(), WB.begin());
+    SB.attr("dim") = Dimension(sums.B, sums.ngroups, sums.ndays);
+    
+    return List::create(Named("Sum_Weights")          = W,
+                        Named("Sums")                 = S,
+                        Named("Replicate_Weights")    = WB,
+                        Named("Replicate_Sums")       = SB);
+}
+
+#endif /* bootstrap_h */
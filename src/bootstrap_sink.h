@@ -0,0 +1,227 @@
+//
+//  bootstrap_sink.h
+//
+//  This is a function that defines a sink of the native engine (see
+//  ode_engine.h) that estimates the (weighted) mean body weight of groups of
+//  individuals at chosen output days together with B Poisson bootstrap
+//  replicates of each mean without keeping trajectories.
+//
+//  Variables:
+//  group           .-  Group of each individual (0, ..., ngroups - 1) or, if
+//                      start is given, groups group[start[i]], ...,
+//                      group[start[i + 1] - 1] of individual i (groups that
+//                      overlap, e.g. subsets of bitmap_index.h)
+//  w               .-  Weights of individuals (e.g. survey weights)
+//  id              .-  Identifier of each individual
+//  B               .-  Number of bootstrap replicates
+//  seed            .-  Seed of the replicates
+//  steps           .-  Output steps (days/dt) where means are estimated
+//
+//  Individual i enters replicate b m times with m ~ Poisson(1) drawn from a
+//  hash of (seed, id, b) instead of a random stream so replicates do not depend
+//  on the order in which blocks (threads) run and sums of blocks, threads or
+//  runs over chunks of the population are merged by adding them. Replicate b
+//  of the mean of group g at day d is SB[b,g,d]/WB[b,g].
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef bootstrap_sink_h
+#define bootstrap_sink_h
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+#include <stdexcept>
+#include "alloc_counter.h"
+
+//Sums of the bootstrap (by column as R arrays)
+//--------------------------------------------------------------------------------
+struct BootstrapSums {
+
+    int B;       //Replicates
+    int ngroups; //Groups
+    int ndays;   //Output days
+
+    std::vector<double> W;  //sum w per group                        (ngroups)
+    std::vector<double> S;  //sum w y per group and day              (ngroups x ndays)
+    std::vector<double> WB; //sum m w per replicate and group        (B x ngroups)
+    std::vector<double> SB; //sum m w y per replicate, group and day (B x ngroups x ndays)
+
+    BootstrapSums(void){
+        B       = 0;
+        ngroups = 0;
+        ndays   = 0;
+    }
+
+    void resize(int input_B, int input_ngroups, int input_ndays){
+        B       = input_B;
+        ngroups = input_ngroups;
+        ndays   = input_ndays;
+        W.assign(ngroups, 0.0);
+        S.assign(((size_t) ngroups)*ndays, 0.0);
+        WB.assign(((size_t) B)*ngroups, 0.0);
+        SB.assign(((size_t) B)*ngroups*ndays, 0.0);
+    }
+
+    void add(const BootstrapSums& other){
+        for (size_t k = 0; k < W.size(); k++)  W[k]  += other.W[k];
+        for (size_t k = 0; k < S.size(); k++)  S[k]  += other.S[k];
+        for (size_t k = 0; k < WB.size(); k++) WB[k] += other.WB[k];
+        for (size_t k = 0; k < SB.size(); k++) SB[k] += other.SB[k];
+    }
+};
+
+//Poisson(1) multiplier of individual id in replicate b (splitmix64 hash
+//to a uniform and inverse of the cumulative distribution)
+inline int bootstrapMultiplier(uint64_t seed, uint64_t id, uint64_t b){
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL*(id + 1) + 0xD1B54A32D192ED03ULL*(b + 1);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    double u = (z >> 11)*(1.0/9007199254740992.0);
+
+    int    m = 0;
+    double p = std::exp(-1.0);
+    double F = p;
+    while (u > F && m < 20){
+        m++;
+        p /= m;
+        F += p;
+    }
+    return m;
+}
+
+//Sink of the engine: the model gives body weight with
+//  double bodyWeight(int i, double t, const double* y, int j, int n) const;
+//--------------------------------------------------------------------------------
+template <class Model>
+class BootstrapSink {
+public:
+
+    BootstrapSink(const Model& input_model, const int* input_group, const double* input_w,
+                  const double* input_id, int input_ngroups, int input_B, double input_seed,
+                  std::vector<int> input_steps, const int* input_start = NULL) : model(input_model) {
+        group   = input_group;
+        start   = input_start;
+        w       = input_w;
+        id      = input_id;
+        ngroups = input_ngroups;
+        B       = input_B;
+        //Casting a negative, fractional or non-finite seed to uint64_t is undefined
+        if (!(input_seed >= 0 && input_seed < 18446744073709551616.0) || input_seed != std::floor(input_seed)){
+            throw std::invalid_argument("Invalid seed of bootstrap.");
+        }
+        seed    = (uint64_t) input_seed;
+        steps   = input_steps;
+    }
+
+    void begin(int nsteps, int nind, int nstates){
+        index.assign(nsteps + 1, -1);
+        for (size_t d = 0; d < steps.size(); d++){
+            if (steps[d] < 0 || steps[d] > nsteps) continue;
+            if (index[steps[d]] >= 0){
+                throw std::invalid_argument("Output days of bootstrap fall on the same step.");
+            }
+            index[steps[d]] = d;
+        }
+        sums.resize(B, ngroups, steps.size());
+    }
+
+    //Each block accumulates its own sums
+    BootstrapSink fork(void){
+        BootstrapSink local = *this;
+        local.sums.resize(B, ngroups, steps.size());
+        return local;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+
+        //Multipliers of individuals in block (same for every day)
+        if (step == 0){
+            m.resize(((size_t) n)*B);
+            for (int j = 0; j < n; j++){
+                int i = first + j;
+                for (int b = 0; b < B; b++){
+                    m[((size_t) j)*B + b] = bootstrapMultiplier(seed, (uint64_t) id[i], b);
+                }
+                for (int k = groupBegin(i); k < groupEnd(i); k++){
+                    int g = group[k];
+                    sums.W[g] += w[i];
+                    for (int b = 0; b < B; b++){
+                        sums.WB[((size_t) g)*B + b] += m[((size_t) j)*B + b]*w[i];
+                    }
+                }
+            }
+        }
+
+        //Means at output days
+        int d = index[step];
+        if (d < 0) return;
+        for (int j = 0; j < n; j++){
+            int    i  = first + j;
+            if (groupBegin(i) == groupEnd(i)) continue;
+            double wy = w[i]*model.bodyWeight(i, t, y, j, n);
+            const double* mj = &m[((size_t) j)*B];
+            for (int k = groupBegin(i); k < groupEnd(i); k++){
+                int     g  = group[k];
+                double* SB = &sums.SB[(((size_t) d)*ngroups + g)*B];
+                sums.S[((size_t) d)*ngroups + g] += wy;
+                for (int b = 0; b < B; b++) SB[b] += mj[b]*wy;
+            }
+        }
+    }
+
+    void join(const BootstrapSink& local){
+        sums.add(local.sums);
+    }
+
+    void end(void){}
+
+    BootstrapSums sums;
+
+private:
+
+    const Model&        model;
+    const int*          group;
+    const int*          start; //Groups of individuals (NULL for one group each)
+    const double*       w;
+    const double*       id;
+    int                 ngroups;
+    int                 B;
+    uint64_t            seed;
+    std::vector<int>    steps;
+    std::vector<int>    index; //Output day of each step (-1 if none)
+    WorkVector          m;     //Multipliers of individuals in block (B per individual)
+
+    //Groups of individual i are group[k] for groupBegin(i) <= k < groupEnd(i)
+    inline int groupBegin(int i) const {
+        return (start == NULL) ? i : start[i];
+    }
+
+    inline int groupEnd(int i) const {
+        return (start == NULL) ? i + 1 : start[i + 1];
+    }
+};
+
+#endif /* bootstrap_sink_h */
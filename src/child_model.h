@@ -0,0 +1,542 @@
+//
+//  child_model.h
+//
+//  This is a function that defines the native derivative kernel of the
+//  children weight model (Hall et al. 2013) for the engine in ode_engine.h.
+//  It has the same equations as Child::dMass (child_weight.cpp) written as a
+//  loop over a block of individuals on plain arrays so that it can run in
+//  worker threads. Kernels are built on the main thread from a Child with
+//  Child::nativeModel().
+//
+//  States (nstates = 2):
+//  0               .-  Fat Free Mass (kg)
+//  1               .-  Fat Mass (kg)
+//
+//  Time t is in days since the start of the model; age is age + t/365.
+//
+//  Reference children (at the reference fat and fat free mass of their age
+//  with the reference energy intake) of the same age, sex and BMI category
+//  have the same trajectory: referenceCohorts() finds them so that only the
+//  first child of each cohort is integrated (see Child::solve).
+//
+//  The growth function is that of the Dynamics paper (Growth_dynamic) or of
+//  the Impact paper (Growth_impact) as chosen by variant. ChildGrowthModel
+//  (nstates = 4) integrates every child under both growth functions in the
+//  same pass sharing the intake, energy balance and reference terms.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef child_model_h
+#define child_model_h
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include "input_view.h"
+#include "child_reference.h"
+
+//Growth variants
+#define CHILD_GROWTH_DYNAMIC 0
+#define CHILD_GROWTH_IMPACT  1
+#define CHILD_GROWTH_BOTH    2
+
+//Sex specific constants of a child (sex 0 for male and 1 for female), used by
+//ChildModel::setConstants for Child::nativeModel and the C API (engine_api.cpp)
+//--------------------------------------------------------------------------------
+struct ChildConstants {
+
+    double K;
+    double deltamax;
+
+    //Growth function from Dynamics paper
+    double A, B, D, tA, tB, tD, tauA, tauB, tauD;
+
+    //Energy balance from Impact paper
+    double A_EB, B_EB, D_EB, tA_EB, tB_EB, tD_EB, tauA_EB, tauB_EB, tauD_EB;
+
+    //Growth function from Impact paper
+    double A1, B1, D1, tA1, tB1, tD1, tauA1, tauB1, tauD1;
+
+    explicit ChildConstants(double sex){
+        K        = 800*(1 - sex)  + 700*sex;
+        deltamax = 19*(1 - sex)   + 17*sex;
+        A        = 3.2*(1 - sex)  + 2.3*sex;
+        B        = 9.6*(1 - sex)  + 8.4*sex;
+        D        = 10.1*(1 - sex) + 1.1*sex;
+        tA       = 4.7*(1 - sex)  + 4.5*sex;       //years
+        tB       = 12.5*(1 - sex) + 11.7*sex;      //years
+        tD       = 15.0*(1-sex)   + 16.2*sex;      //years
+        tauA     = 2.5*(1 - sex)  + 1.0*sex;       //years
+        tauB     = 1.0*(1 - sex)  + 0.9*sex;       //years
+        tauD     = 1.5*(1 - sex)  + 0.7*sex;       //years
+        A_EB     = 7.2*(1 - sex)  + 16.5*sex;
+        B_EB     = 30*(1 - sex)   + 47.0*sex;
+        D_EB     = 21*(1 - sex)   + 41.0*sex;
+        tA_EB    = 5.6*(1 - sex)  + 4.8*sex;
+        tB_EB    = 9.8*(1 - sex)  + 9.1*sex;
+        tD_EB    = 15.0*(1 - sex) + 13.5*sex;
+        tauA_EB  = 15*(1 - sex)   + 7.0*sex;
+        tauB_EB  = 1.5*(1 -sex)   + 1.0*sex;
+        tauD_EB  = 2.0*(1 - sex)  + 1.5*sex;
+        A1       = 3.2*(1 - sex)  + 2.3*sex;
+        B1       = 9.6*(1 - sex)  + 8.4*sex;
+        D1       = 10.0*(1 - sex) + 1.1*sex;
+        tA1      = 4.7*(1 - sex)  + 4.5*sex;
+        tB1      = 12.5*(1 - sex) + 11.7*sex;
+        tD1      = 15.0*(1 - sex) + 16.0*sex;
+        tauA1    = 1.0*(1 - sex)  + 1.0*sex;
+        tauB1    = 0.94*(1 - sex) + 0.94*sex;
+        tauD1    = 0.69*(1 - sex) + 0.69*sex;
+    }
+};
+
+class ChildModel {
+public:
+
+    static const int nstates = 2;
+
+    //Initial states and age
+    std::vector<double> FFM;
+    std::vector<double> FM;
+    std::vector<double> age;
+
+    //Energy intake (view of matrix or file) or Richardson's curve
+    InputView EIntake;
+    bool      generalized_logistic;
+    double    K_logistic, Q_logistic, A_logistic, B_logistic, nu_logistic, C_logistic;
+
+    //Constants
+    double rhoFM;
+    double deltamin;
+    double P;
+    double h;
+    double dt;
+
+    //Individual constants
+    std::vector<double> K;
+    std::vector<double> deltamax;
+
+    //Growth function from Dynamics paper
+    std::vector<double> A, B, D, tA, tB, tD, tauA, tauB, tauD;
+
+    //Growth function from Impact paper
+    std::vector<double> A1, B1, D1, tA1, tB1, tD1, tauA1, tauB1, tauD1;
+    int variant; //Growth function used (CHILD_GROWTH_DYNAMIC or CHILD_GROWTH_IMPACT)
+
+    //Energy balance from Impact paper
+    std::vector<double> A_EB, B_EB, D_EB, tA_EB, tB_EB, tD_EB, tauA_EB, tauB_EB, tauD_EB;
+
+    //Reference fat free and fat mass at ages 2, ..., 18 (reference at age 2 + a of
+    //individual i at i*CHILD_REFERENCE_AGES + a)
+    std::vector<double> FFMref;
+    std::vector<double> FMref;
+
+    int size(void) const {
+        return age.size();
+    }
+
+    //Sex specific constants of nind individuals
+    void setConstants(const double* sex, int nind){
+        std::vector<double>* values[] = {&K, &deltamax, &A, &B, &D, &tA, &tB, &tD, &tauA,
+                                         &tauB, &tauD, &A_EB, &B_EB, &D_EB, &tA_EB, &tB_EB,
+                                         &tD_EB, &tauA_EB, &tauB_EB, &tauD_EB, &A1, &B1, &D1,
+                                         &tA1, &tB1, &tD1, &tauA1, &tauB1, &tauD1};
+        for (size_t v = 0; v < sizeof(values)/sizeof(values[0]); v++){
+            values[v]->resize(nind);
+        }
+        for (int i = 0; i < nind; i++){
+            ChildConstants c(sex[i]);
+            K[i]    = c.K;    deltamax[i] = c.deltamax;
+            A[i]    = c.A;    B[i]    = c.B;    D[i]    = c.D;
+            tA[i]   = c.tA;   tB[i]   = c.tB;   tD[i]   = c.tD;
+            tauA[i] = c.tauA; tauB[i] = c.tauB; tauD[i] = c.tauD;
+            A_EB[i]    = c.A_EB;    B_EB[i]    = c.B_EB;    D_EB[i]    = c.D_EB;
+            tA_EB[i]   = c.tA_EB;   tB_EB[i]   = c.tB_EB;   tD_EB[i]   = c.tD_EB;
+            tauA_EB[i] = c.tauA_EB; tauB_EB[i] = c.tauB_EB; tauD_EB[i] = c.tauD_EB;
+            A1[i]    = c.A1;    B1[i]    = c.B1;    D1[i]    = c.D1;
+            tA1[i]   = c.tA1;   tB1[i]   = c.tB1;   tD1[i]   = c.tD1;
+            tauA1[i] = c.tauA1; tauB1[i] = c.tauB1; tauD1[i] = c.tauD1;
+        }
+    }
+
+    void check(int nsteps) const {
+        if (!generalized_logistic){
+            EIntake.check(nsteps, "EI");
+        }
+    }
+
+    void initial(double* y, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            y[j]     = FFM[first + j];
+            y[n + j] = FM[first + j];
+        }
+    }
+
+    //Body weight of individual i (state j of block of n)
+    inline double bodyWeight(int i, double t, const double* y, int j, int n) const {
+        return y[j] + y[n + j];
+    }
+
+    //Growth and energy balance terms
+    inline double general_ode(double t, double a, double b, double d, double ta, double tb,
+                              double td, double taua, double taub, double taud) const {
+        return a*std::exp(-(t - ta)/taua) + b*std::exp(-0.5*std::pow((t - tb)/taub, 2)) +
+               d*std::exp(-0.5*std::pow((t - td)/taud, 2));
+    }
+
+    inline double Growth_dynamic(int i, double years) const {
+        return general_ode(years, A[i], B[i], D[i], tA[i], tB[i], tD[i], tauA[i], tauB[i], tauD[i]);
+    }
+
+    inline double Growth_impact(int i, double years) const {
+        return general_ode(years, A1[i], B1[i], D1[i], tA1[i], tB1[i], tD1[i], tauA1[i], tauB1[i], tauD1[i]);
+    }
+
+    inline double Growth(int i, double years) const {
+        return variant == CHILD_GROWTH_IMPACT ? Growth_impact(i, years) : Growth_dynamic(i, years);
+    }
+
+    inline double EB_impact(int i, double years) const {
+        return general_ode(years, A_EB[i], B_EB[i], D_EB[i], tA_EB[i], tB_EB[i], tD_EB[i],
+                           tauA_EB[i], tauB_EB[i], tauD_EB[i]);
+    }
+
+    inline double Delta(int i, double years) const {
+        return deltamin + (deltamax[i] - deltamin)*(1.0/(1.0 + std::pow(years/P, h)));
+    }
+
+    //Linear interpolation of reference table as in Child::FFMReference
+    inline double Reference(const std::vector<double>& table, int i, double years) const {
+        const double* ref = &table[((size_t) i)*CHILD_REFERENCE_AGES];
+        if (years >= 18.0){
+            return ref[16];
+        }
+        int jmin = std::max((int) std::floor(years), 2) - 2;
+        int jmax = std::min(jmin + 1, 16);
+        double diff = years - std::floor(years);
+        return ref[jmin] + diff*(ref[jmax] - ref[jmin]);
+    }
+
+    //Reference intake is base + growth*slope (terms that do not depend on growth in base)
+    inline void IntakeReferenceTerms(int i, double years, double delta, double& base, double& slope) const {
+        double EB     = EB_impact(i, years);
+        double ffmref = Reference(FFMref, i, years);
+        double fmref  = Reference(FMref, i, years);
+        double rhoFFM = 4.3*ffmref + 837.0;
+        double C      = 10.4*rhoFFM/rhoFM;
+        double p      = C/(C + fmref);
+        base  = EB + K[i] + (22.4 + delta)*ffmref + (4.5 + delta)*fmref +
+                230.0/rhoFFM*p*EB + 180.0/rhoFM*(1 - p)*EB;
+        slope = 230.0/rhoFFM - 180.0/rhoFM;
+    }
+
+    inline double IntakeReference(int i, double years) const {
+        double base, slope;
+        IntakeReferenceTerms(i, years, Delta(i, years), base, slope);
+        return base + Growth(i, years)*slope;
+    }
+
+    //Intake at day t is row floor(t/dt) of EIntake. Child::Intake (legacy) uses
+    //floor(365*(AGE - age)/dt) with AGE accumulated one step at a time, which
+    //rounds down to the previous row at some steps; with an intake that
+    //changes over time both methods differ by that lag (about 1e-3 kg in ten
+    //years for an intake that changes 0.1 kcal a day) while with a constant
+    //intake they agree to rounding.
+    inline double Intake(int i, double t, double years) const {
+        if (generalized_logistic){
+            return A_logistic + (K_logistic - A_logistic)/
+                   std::pow(C_logistic + Q_logistic*std::exp(-B_logistic*years), 1/nu_logistic);
+        }
+        return EIntake((int) std::floor(t/dt + 1.0e-9), i);
+    }
+
+    //Derivatives of child i with fat free mass ffm and fat mass fm given its intake,
+    //reference intake, growth and delta (same as Child::dMass)
+    inline void dMass(int i, double ffm, double fm, double intake, double iref, double growth,
+                      double delta, double& dffm, double& dfm) const {
+        double rhoFFM = 4.3*ffm + 837.0;
+        double C      = 10.4*rhoFFM/rhoFM;
+        double p      = C/(C + fm);
+        double DeltaI = intake - iref;
+        double partition = 230.0/rhoFFM*p + 180.0/rhoFM*(1.0 - p);
+        double expend = (K[i] + (22.4 + delta)*ffm + (4.5 + delta)*fm + 0.24*DeltaI +
+                         partition*intake + growth*(230.0/rhoFFM - 180.0/rhoFM))/(1.0 + partition);
+        dffm = (p*(intake - expend) + growth)/rhoFFM;
+        dfm  = ((1.0 - p)*(intake - expend) - growth)/rhoFM;
+    }
+
+    //Batch derivative kernel
+    void derivatives(double t, const double* y, double* dy, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            int    i      = first + j;
+            double years  = age[i] + t/365.0;
+            double growth = Growth(i, years);
+            double delta  = Delta(i, years);
+            double intake = Intake(i, t, years);
+            double base, slope;
+            IntakeReferenceTerms(i, years, delta, base, slope);
+            dMass(i, y[j], y[n + j], intake, base + growth*slope, growth, delta, dy[j], dy[n + j]);
+        }
+    }
+
+    //Analytic Jacobian of dMass: d dFFM/d FFM at J00, d dFFM/d FM at J01, d dFM/d FFM
+    //at J10 and d dFM/d FM at J11
+    inline void jacobianMass(int i, double ffm, double fm, double intake, double iref, double growth,
+                             double delta, double& J00, double& J01, double& J10, double& J11) const {
+        double rhoFFM = 4.3*ffm + 837.0;
+        double C      = 10.4*rhoFFM/rhoFM;
+        double p      = C/(C + fm);
+        double DeltaI = intake - iref;
+        double diff   = 230.0/rhoFFM - 180.0/rhoFM;
+        double partition = 230.0/rhoFFM*p + 180.0/rhoFM*(1.0 - p);
+        double expend = (K[i] + (22.4 + delta)*ffm + (4.5 + delta)*fm + 0.24*DeltaI +
+                         partition*intake + growth*diff)/(1.0 + partition);
+        double balance = intake - expend;
+        
+        //Derivatives of p, partition and expenditure
+        double drho   = -230.0*4.3/(rhoFFM*rhoFFM); //d (230/rhoFFM)/d FFM
+        double dp_ffm = (10.4*4.3/rhoFM)*fm/((C + fm)*(C + fm));
+        double dp_fm  = -C/((C + fm)*(C + fm));
+        double dpart_ffm = drho*p + diff*dp_ffm;
+        double dpart_fm  = diff*dp_fm;
+        double dE_ffm = ((22.4 + delta) + dpart_ffm*intake + growth*drho - expend*dpart_ffm)/(1.0 + partition);
+        double dE_fm  = ((4.5 + delta) + dpart_fm*intake - expend*dpart_fm)/(1.0 + partition);
+        
+        J00 = (dp_ffm*balance - p*dE_ffm)/rhoFFM - 4.3*(p*balance + growth)/(rhoFFM*rhoFFM);
+        J01 = (dp_fm*balance - p*dE_fm)/rhoFFM;
+        J10 = (-dp_ffm*balance - (1.0 - p)*dE_ffm)/rhoFM;
+        J11 = (-dp_fm*balance - (1.0 - p)*dE_fm)/rhoFM;
+    }
+
+    //Analytic Jacobian of derivatives for the Rosenbrock method: d dFFM/d FFM at J[j], d dFFM/d FM at J[n + j],
+    //d dFM/d FFM at J[2*n + j] and d dFM/d FM at J[3*n + j]
+    void jacobian(double t, const double* y, double* J, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            int    i      = first + j;
+            double years  = age[i] + t/365.0;
+            double growth = Growth(i, years);
+            double delta  = Delta(i, years);
+            double intake = Intake(i, t, years);
+            double base, slope;
+            IntakeReferenceTerms(i, years, delta, base, slope);
+            jacobianMass(i, y[j], y[n + j], intake, base + growth*slope, growth, delta,
+                         J[j], J[n + j], J[2*n + j], J[3*n + j]);
+        }
+    }
+
+    //Child of each cohort of reference children whose trajectory is that of child i (i
+    //if child i is integrated). flag[i] is 1 for reference children, 0 for children
+    //that are integrated and NA (or flag empty) to detect reference children: those at
+    //the reference fat and fat free mass with the reference intake in the first of
+    //their cohort and the same intake in the others.
+    std::vector<int> referenceCohorts(int nsteps, const std::vector<double>& flag) const {
+        
+        std::vector<int> cohort(size());
+        std::map<std::vector<double>, int> first;
+        for (int i = 0; i < size(); i++){
+            
+            cohort[i] = i;
+            double isref = flag.empty() ? NAN : flag[i];
+            if (isref == 0 || (std::isnan(isref) && generalized_logistic)){
+                continue;
+            }
+            
+            //Detect baseline at reference
+            if (std::isnan(isref) &&
+                (!Close(FFM[i], Reference(FFMref, i, age[i])) || !Close(FM[i], Reference(FMref, i, age[i])))){
+                continue;
+            }
+            
+            //Cohort: age, baseline, sex (K) and reference tables (sex and BMI category)
+            std::vector<double> key;
+            key.push_back(age[i]);
+            key.push_back(FFM[i]);
+            key.push_back(FM[i]);
+            key.push_back(K[i]);
+            key.insert(key.end(), FFMref.begin() + ((size_t) i)*CHILD_REFERENCE_AGES,
+                       FFMref.begin() + ((size_t) i + 1)*CHILD_REFERENCE_AGES);
+            key.insert(key.end(), FMref.begin() + ((size_t) i)*CHILD_REFERENCE_AGES,
+                       FMref.begin() + ((size_t) i + 1)*CHILD_REFERENCE_AGES);
+            std::map<std::vector<double>, int>::iterator cohortfirst = first.find(key);
+            
+            //First of cohort has reference intake; others the same intake as the first
+            bool reference = true;
+            for (int k = 0; k <= nsteps && std::isnan(isref) && reference; k++){
+                if (cohortfirst == first.end()){
+                    reference = Close(EIntake(k, i), IntakeReference(i, age[i] + dt*k/365.0));
+                } else {
+                    reference = EIntake(k, i) == EIntake(k, cohortfirst->second);
+                }
+            }
+            if (!reference){
+                continue;
+            }
+            if (cohortfirst == first.end()){
+                first[key] = i;
+            } else {
+                cohort[i] = cohortfirst->second;
+            }
+        }
+        
+        return cohort;
+    }
+    
+    //Model of children index; energy intake of the children is copied into store
+    ChildModel subset(const std::vector<int>& index, std::vector<double>& store) const {
+        
+        ChildModel sub = *this;
+        int m = index.size();
+        std::vector<double>* values[] = {&sub.FFM, &sub.FM, &sub.age, &sub.K, &sub.deltamax,
+                                         &sub.A, &sub.B, &sub.D, &sub.tA, &sub.tB, &sub.tD,
+                                         &sub.tauA, &sub.tauB, &sub.tauD, &sub.A_EB, &sub.B_EB,
+                                         &sub.D_EB, &sub.tA_EB, &sub.tB_EB, &sub.tD_EB,
+                                         &sub.tauA_EB, &sub.tauB_EB, &sub.tauD_EB, &sub.A1,
+                                         &sub.B1, &sub.D1, &sub.tA1, &sub.tB1, &sub.tD1,
+                                         &sub.tauA1, &sub.tauB1, &sub.tauD1};
+        for (size_t v = 0; v < sizeof(values)/sizeof(values[0]); v++){
+            std::vector<double>& value = *values[v];
+            for (int j = 0; j < m; j++) value[j] = value[index[j]];
+            value.resize(m);
+        }
+        for (int j = 0; j < m; j++){
+            std::copy(FFMref.begin() + ((size_t) index[j])*CHILD_REFERENCE_AGES,
+                      FFMref.begin() + ((size_t) index[j] + 1)*CHILD_REFERENCE_AGES,
+                      sub.FFMref.begin() + ((size_t) j)*CHILD_REFERENCE_AGES);
+            std::copy(FMref.begin() + ((size_t) index[j])*CHILD_REFERENCE_AGES,
+                      FMref.begin() + ((size_t) index[j] + 1)*CHILD_REFERENCE_AGES,
+                      sub.FMref.begin() + ((size_t) j)*CHILD_REFERENCE_AGES);
+        }
+        sub.FFMref.resize(((size_t) m)*CHILD_REFERENCE_AGES);
+        sub.FMref.resize(((size_t) m)*CHILD_REFERENCE_AGES);
+        
+        //Intake by column as R matrices
+        if (!generalized_logistic){
+            int nrow = EIntake.nrow;
+            store.resize(((size_t) nrow)*m);
+            for (int j = 0; j < m; j++){
+                for (int k = 0; k < nrow; k++){
+                    store[((size_t) j)*nrow + k] = EIntake(k, index[j]);
+                }
+            }
+            sub.EIntake.values    = store.empty() ? NULL : &store[0];
+            sub.EIntake.fvalues   = NULL;
+            sub.EIntake.rowstride = 1;
+            sub.EIntake.colstride = nrow;
+            sub.EIntake.ncol      = m;
+            sub.EIntake.columns   = NULL;
+        }
+        
+        return sub;
+    }
+    
+    //Equal up to rounding of inputs (e.g. intake stored as float)
+    inline bool Close(double x, double y) const {
+        return std::fabs(x - y) <= 1.0e-6*std::max(std::fabs(y), 1.0);
+    }
+
+    //The children model has no stiff part: IMEX reduces to the explicit midpoint rule
+    void implicitDerivatives(double t, const double* y, double* dy, int first, int n) const {
+        std::fill(dy, dy + nstates*n, 0.0);
+    }
+
+    void implicitSolve(double t, double a, const double* r, double* y, int first, int n) const {
+        std::copy(r, r + nstates*n, y);
+    }
+};
+
+//Children model under both growth functions: states 0 and 1 are the fat free and
+//fat mass with Growth_dynamic and states 2 and 3 with Growth_impact
+class ChildGrowthModel {
+public:
+
+    static const int nstates = 4;
+
+    ChildGrowthModel(const ChildModel& input_model) : model(input_model) {}
+
+    int size(void) const {
+        return model.size();
+    }
+
+    void check(int nsteps) const {
+        model.check(nsteps);
+    }
+
+    void initial(double* y, int first, int n) const {
+        model.initial(y, first, n);
+        model.initial(y + 2*n, first, n);
+    }
+
+    //Intake, delta and reference terms are evaluated once for both growth functions
+    void derivatives(double t, const double* y, double* dy, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            int    i      = first + j;
+            double years  = model.age[i] + t/365.0;
+            double delta  = model.Delta(i, years);
+            double intake = model.Intake(i, t, years);
+            double base, slope;
+            model.IntakeReferenceTerms(i, years, delta, base, slope);
+            double dynamic = model.Growth_dynamic(i, years);
+            double impact  = model.Growth_impact(i, years);
+            model.dMass(i, y[j], y[n + j], intake, base + dynamic*slope, dynamic, delta,
+                        dy[j], dy[n + j]);
+            model.dMass(i, y[2*n + j], y[3*n + j], intake, base + impact*slope, impact, delta,
+                        dy[2*n + j], dy[3*n + j]);
+        }
+    }
+
+    //Block diagonal Jacobian (J[(k*nstates + l)*n + j] is d dy_k/d y_l)
+    void jacobian(double t, const double* y, double* J, int first, int n) const {
+        for (int j = 0; j < n; j++){
+            int    i      = first + j;
+            double years  = model.age[i] + t/365.0;
+            double delta  = model.Delta(i, years);
+            double intake = model.Intake(i, t, years);
+            double base, slope;
+            model.IntakeReferenceTerms(i, years, delta, base, slope);
+            double dynamic = model.Growth_dynamic(i, years);
+            double impact  = model.Growth_impact(i, years);
+            for (int k = 0; k < nstates*nstates; k++){
+                J[k*n + j] = 0.0;
+            }
+            model.jacobianMass(i, y[j], y[n + j], intake, base + dynamic*slope, dynamic, delta,
+                               J[j], J[n + j], J[4*n + j], J[5*n + j]);
+            model.jacobianMass(i, y[2*n + j], y[3*n + j], intake, base + impact*slope, impact, delta,
+                               J[10*n + j], J[11*n + j], J[14*n + j], J[15*n + j]);
+        }
+    }
+
+    void implicitDerivatives(double t, const double* y, double* dy, int first, int n) const {
+        std::fill(dy, dy + nstates*n, 0.0);
+    }
+
+    void implicitSolve(double t, double a, const double* r, double* y, int first, int n) const {
+        std::copy(r, r + nstates*n, y);
+    }
+
+private:
+    const ChildModel& model; //Outlives the solve (not copied)
+};
+
+#endif /* child_model_h */
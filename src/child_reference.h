@@ -0,0 +1,131 @@
+//
+//  child_reference.h
+//
+//  This is a function that defines the reference fat free mass and fat mass
+//  of children by age (2 to 18 years), sex and BMI category used by the native
+//  kernel (Child::nativeModel) and by the C interface built without R
+//  (engine_api.cpp). They are the tables of Child::FFMReference and
+//  Child::FMReference (child_weight.cpp), which the legacy solver keeps.
+//  Reference values before 6 years do not depend on the BMI category.
+//
+//  Variables:
+//  stat            .-  0 = mean; 1 = median (referenceValues)
+//  sex             .-  0 = male; 1 = female
+//  bmiCat          .-  1 to 4: underweight, normal, overweight and obese
+//  a               .-  Age 2 + a
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef child_reference_h
+#define child_reference_h
+
+//Number of ages (2 to 18) in reference tables
+#define CHILD_REFERENCE_AGES 17
+
+//Reference fat free mass (kg) by stat, sex, BMI category and age
+static const double CHILD_FFM_REFERENCE[2][2][4][CHILD_REFERENCE_AGES] = {
+    {
+        //Mean: male
+        {
+            {10.134, 12.099, 14.0, 15.72, 12.7942, 17.8106, 20.3597, 19.3668, 23.9096, 23.5033, 24.7662, 28.9497, 33.9297, 35.2601, 40.5041, 42.0445, 44.0779},
+            {10.134, 12.099, 14.0, 15.72, 17.0238, 19.0775, 20.4774, 22.3768, 24.8998, 27.5943, 31.5163, 36.3432, 40.9730, 43.7795, 46.9540, 47.8972, 49.6930},
+            {10.134, 12.099, 14.0, 15.72, 19.3070, 20.3344, 22.1128, 26.7714, 30.4866, 32.6556, 37.5262, 41.6549, 48.0671, 49.3493, 52.9435, 55.8888, 56.5725},
+            {10.134, 12.099, 14.0, 15.72, 22.2248, 23.1765, 25.8151, 31.3143, 34.1717, 38.2638, 42.3513, 48.1398, 50.1084, 55.6289, 58.9917, 58.7117, 61.7620}
+        },
+        //Mean: female
+        {
+            {9.477, 11.494, 13.2, 14.86, 13.7957, 18.4835, 18.5363, 17.0314, 19.1085, 23.3318, 25.9357, 30.2351, 33.6380, 33.0539, 32.9676, 32.3827, 35.5248},
+            {9.477, 11.494, 13.2, 14.86, 15.2337, 17.5198, 19.6317, 21.3680, 24.0922, 28.2737, 31.9490, 34.3348, 36.1797, 38.1065, 40.1114, 39.6064, 41.2798},
+            {9.477, 11.494, 13.2, 14.86, 17.7866, 18.9406, 21.6080, 26.1791, 30.3541, 34.1915, 37.0654, 39.1559, 40.9960, 42.8965, 45.6216, 46.1784, 45.9979},
+            {9.477, 11.494, 13.2, 14.86, 21.2170, 22.2733, 25.1641, 30.1484, 35.2838, 37.0428, 42.5446, 44.0205, 46.0726, 48.6841, 49.7917, 51.0534, 49.8746}
+        }
+    },
+    {
+        //Median: male
+        {
+            {10.134, 12.099, 14.0, 15.72, 14.4641, 16.3729, 18.0019, 19.2548, 23.9096, 23.7557, 24.1310, 28.2941, 33.7396, 35.7472, 41.8846, 42.6661, 42.8578},
+            {10.134, 12.099, 14.0, 15.72, 17.1430, 18.2285, 19.9148, 21.9058, 24.8603, 27.4756, 31.2494, 36.0685, 40.9866, 44.0430, 46.8444, 48.2625, 49.4174},
+            {10.134, 12.099, 14.0, 15.72, 19.2280, 21.7099, 24.6404, 26.5243, 29.9298, 32.4980, 37.7967, 41.4671, 47.9945, 49.7454, 53.3482, 55.9614, 56.7387},
+            {10.134, 12.099, 14.0, 15.72, 21.9501, 24.9713, 27.4774, 30.8636, 34.1859, 38.1778, 42.8213, 48.1462, 50.9872, 54.9071, 58.5851, 58.4194, 63.6968}
+        },
+        //Median: female
+        {
+            {9.477, 11.494, 13.2, 14.86, 13.8627, 16.6347, 17.2583, 17.5150, 20.1493, 24.0089, 25.5209, 32.6849, 37.2420, 32.2773, 33.0258, 31.6275, 37.5435},
+            {9.477, 11.494, 13.2, 14.86, 15.1282, 17.2507, 19.4286, 21.2721, 23.6199, 28.2708, 32.2679, 33.7855, 35.9762, 38.2639, 39.6752, 39.5399, 41.5349},
+            {9.477, 11.494, 13.2, 14.86, 17.6859, 20.0341, 22.1758, 25.6952, 29.5716, 32.8672, 36.7435, 38.6218, 40.9744, 43.1117, 45.7056, 47.2530, 45.9623},
+            {9.477, 11.494, 13.2, 14.86, 20.4992, 23.4162, 26.8346, 29.2900, 34.1346, 37.5833, 42.2971, 43.5195, 45.6421, 48.1360, 48.9594, 50.7464, 50.0229}
+        }
+    }
+};
+
+//Reference fat mass (kg) by stat, sex, BMI category and age
+static const double CHILD_FM_REFERENCE[2][2][4][CHILD_REFERENCE_AGES] = {
+    {
+        //Mean: male
+        {
+            {2.456, 2.576, 2.7, 3.66, 1.7764, 2.3398, 3.2767, 2.3902, 2.9954, 2.6803, 2.8835, 3.1579, 3.6857, 3.9803, 4.6019, 4.8405, 4.6858},
+            {2.456, 2.576, 2.7, 3.66, 3.4540, 3.5859, 4.1138, 4.1705, 4.5465, 5.0225, 5.9324, 7.0763, 8.3966, 9.0181, 10.0921, 10.0547, 10.7726},
+            {2.456, 2.576, 2.7, 3.66, 4.8055, 5.4625, 5.5455, 6.6958, 8.1191, 8.7335, 10.5608, 12.3945, 15.0498, 15.5611, 18.1619, 19.2423, 19.1356},
+            {2.456, 2.576, 2.7, 3.66, 7.9672, 8.4350, 9.3266, 11.5896, 13.4114, 15.2821, 18.3024, 21.7342, 24.2628, 27.0142, 30.8170, 30.7942, 35.6945}
+        },
+        //Mean: female
+        {
+            {2.433, 2.606, 2.8, 4.47, 2.5951, 2.8164, 3.0828, 2.6538, 3.1389, 3.8049, 4.2002, 4.7942, 5.3309, 5.2442, 4.8228, 4.8583, 5.3332},
+            {2.433, 2.606, 2.8, 4.47, 3.8303, 4.2782, 5.2226, 5.0218, 5.7742, 6.9162, 8.2706, 9.1606, 10.0249, 10.5653, 11.4444, 10.6654, 11.3437},
+            {2.433, 2.606, 2.8, 4.47, 5.7014, 6.5960, 7.3667, 8.6945, 10.6667, 12.3291, 14.4379, 15.0401, 17.1050, 17.5730, 19.9088, 19.4731, 19.0598},
+            {2.433, 2.606, 2.8, 4.47, 9.3883, 10.4148, 12.0550, 14.1436, 17.3329, 19.0058, 24.9390, 28.2547, 29.7700, 29.9077, 31.2351, 31.1807, 30.3288}
+        }
+    },
+    {
+        //Median: male
+        {
+            {2.456, 2.576, 2.7, 3.66, 2.0359, 2.3771, 2.1231, 2.4068, 2.9954, 2.7443, 2.8190, 3.0059, 3.7104, 4.4546, 4.6585, 4.8189, 4.5259},
+            {2.456, 2.576, 2.7, 3.66, 3.4642, 3.6030, 3.6729, 4.0597, 4.5932, 4.7619, 5.5671, 6.7689, 8.4317, 8.7820, 9.5728, 10.3426, 10.7497},
+            {2.456, 2.576, 2.7, 3.66, 4.6220, 5.5651, 5.8971, 6.5720, 8.0701, 8.6445, 10.2431, 12.0232, 15.2507, 15.6754, 18.3549, 18.9543, 18.9053},
+            {2.456, 2.576, 2.7, 3.66, 7.1058, 8.0501, 8.9372, 10.8084, 12.3133, 14.4743, 17.3155, 21.0382, 22.9540, 25.5113, 29.9916, 27.2116, 31.9253}
+        },
+        //Median: female
+        {
+            {2.433, 2.606, 2.8, 4.47, 2.5660, 2.9560, 3.0917, 2.9027, 3.1757, 3.8911, 4.1099, 5.3651, 5.8580, 5.2493, 4.8742, 4.7975, 5.7815},
+            {2.433, 2.606, 2.8, 4.47, 3.7042, 4.1865, 4.8531, 4.8707, 5.4455, 6.9604, 8.3722, 9.2549, 9.8827, 10.3785, 11.4776, 10.3454, 10.9042},
+            {2.433, 2.606, 2.8, 4.47, 5.6735, 6.4374, 7.0172, 8.7112, 10.6143, 11.7518, 14.7437, 14.6163, 16.2256, 17.3977, 19.7533, 19.3869, 19.1592},
+            {2.433, 2.606, 2.8, 4.47, 8.7339, 9.3100, 11.5469, 12.7559, 15.7121, 17.4123, 22.9359, 26.6716, 27.6643, 28.0559, 30.6943, 29.9799, 28.3702}
+        }
+    }
+};
+
+//Reference value of table at age 2 + a (0 for an invalid stat or, from 6 years,
+//an invalid BMI category as in Child::FFMReference)
+inline double childReference(const double table[2][2][4][CHILD_REFERENCE_AGES], double stat,
+                             double sex, double bmiCat, int a){
+    if (stat != 0 && stat != 1){
+        return 0.0;
+    }
+    if (bmiCat != 1 && bmiCat != 2 && bmiCat != 3 && bmiCat != 4){
+        return a < 4 ? table[(int) stat][sex == 1][0][a] : 0.0;
+    }
+    return table[(int) stat][sex == 1][(int) bmiCat - 1][a];
+}
+
+#endif /* child_reference_h */
@@ -71,10 +71,15 @@
 
 
 #include "child_weight.h"
+#include "ode_engine.h"
+#include "regression.h"
+#include "bootstrap.h"
+#include "result_file.h"
+#include "alloc_report.h"
 
 //Default (classic) constructor for energy matrix
-Child::Child(NumericVector input_age, NumericVector input_sex, NumericVector input_bmiCat, NumericVector input_FFM, NumericVector input_FM, NumericMatrix input_EIntake,
-             double input_dt, bool checkValues, double input_referenceValues){
+Child::Child(NumericVector input_age, NumericVector input_sex, NumericVector input_bmiCat, NumericVector input_FFM, NumericVector input_FM, InputMatrix input_EIntake,
+             double input_dt, bool checkValues, double input_referenceValues, bool input_allocations){
     age   = input_age;
     sex   = input_sex;
     bmiCat = input_bmiCat;
@@ -85,13 +90,14 @@ Child::Child(NumericVector input_age, NumericVector input_sex, NumericVector inp
     check = checkValues;
     generalized_logistic = false;
     referenceValues = input_referenceValues;
+    allocations = input_allocations;
     build();
 }
 
 //Constructor which uses Richard's curve with the parameters of https://en.wikipedia.org/wiki/Generalised_logistic_function
 Child::Child(NumericVector input_age, NumericVector input_sex,  NumericVector input_bmiCat, NumericVector input_FFM, NumericVector input_FM, double input_K,
              double input_Q, double input_A, double input_B, double input_nu, double input_C, 
-             double input_dt, bool checkValues, double input_referenceValues){
+             double input_dt, bool checkValues, double input_referenceValues, bool input_allocations){
     age   = input_age;
     sex   = input_sex;
     bmiCat = input_bmiCat;
@@ -107,7 +113,7 @@ Child::Child(NumericVector input_age, NumericVector input_sex,  NumericVector in
     check = checkValues;
     referenceValues = input_referenceValues;
     generalized_logistic = true;
-    ;
+    allocations = input_allocations;
     build();
 }
 
@@ -330,6 +336,7 @@ NumericVector Child::Expenditure(NumericVector t, NumericVector FFM, NumericVect
 }
 
 //Rungue Kutta 4 method for Adult
+//Reference of every other method (method = "legacy"; see engine_compare in R): keep unchanged
 List Child::rk4 (double days){
     
     //Initial time
@@ -390,6 +397,197 @@ List Child::rk4 (double days){
 
 }
 
+//Solve with native engine: method is one of "rk4", "rk45", "abm", "imex" or "rosenbrock"
+//and nthreads the number of threads (0 = all cores). If output is a directory
+//trajectories are written into result files in it (result_file.h). With growth =
+//CHILD_GROWTH_BOTH rows 0, ..., nind - 1 are the children with Growth_dynamic and
+//rows nind, ..., 2*nind - 1 the same children with Growth_impact
+List Child::solve(double days, std::string method, int nthreads, NumericVector reference, std::string output, int growth){
+    
+    //Estimate number of elements to loop into
+    int nsims = floor(days/dt);
+    
+    //Rows of results
+    int nvariants = (growth == CHILD_GROWTH_BOTH) ? 2 : 1;
+    int nrow      = nvariants*nind;
+    
+    //Create array of states
+    NumericMatrix ModelFFM = resultMatrix(nrow, nsims + 1, resultPath(output, "Fat_Free_Mass"));
+    NumericMatrix ModelFM  = resultMatrix(nrow, nsims + 1, resultPath(output, "Fat_Mass"));
+    NumericMatrix ModelBW  = resultMatrix(nrow, nsims + 1, resultPath(output, "Body_Weight"));
+    NumericMatrix AGE      = resultMatrix(nrow, nsims + 1, resultPath(output, "Age"));
+    NumericVector TIME(nsims + 1); //in rcpp
+    
+    //Reference children of a cohort have the trajectory of the first of them
+    //(see ChildModel::referenceCohorts) which is the only one integrated. Cohorts
+    //have the same inputs so they are also cohorts under Growth_impact
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ChildModel model = nativeModel();
+    model.variant    = (growth == CHILD_GROWTH_IMPACT) ? CHILD_GROWTH_IMPACT : CHILD_GROWTH_DYNAMIC;
+    std::vector<int> cohort = model.referenceCohorts(nsims, std::vector<double>(reference.begin(), reference.end()));
+    std::vector<int> index;
+    std::vector<int> position(nind);
+    for (int i = 0; i < nind; i++){
+        if (cohort[i] == i){
+            position[i] = index.size();
+            index.push_back(i);
+        }
+    }
+    int nreference = nind - index.size();
+    
+    std::vector<double> store;
+    if (nreference > 0){
+        model = model.subset(index, store);
+    }
+    
+    //Engine writes states directly into matrices (into matrices of integrated
+    //children when trajectories are copied to cohorts or variants)
+    bool copy = nreference > 0 || nvariants > 1;
+    std::vector<NumericMatrix> solved;
+    std::vector<double*> out;
+    if (copy){
+        for (int k = 0; k < 2*nvariants; k++){
+            solved.push_back(NumericMatrix(index.size(), nsims + 1));
+            out.push_back(solved[k].begin());
+        }
+    } else {
+        out.push_back(ModelFFM.begin());
+        out.push_back(ModelFM.begin());
+    }
+    DenseSink sink(out);
+    double setup = secondsSince(start);
+    
+    start = std::chrono::steady_clock::now();
+    EngineStats stats;
+    if (nvariants > 1){
+        stats = solveModel(ChildGrowthModel(model), dt, nsims, method, nthreads, sink);
+    } else {
+        stats = solveModel(model, dt, nsims, method, nthreads, sink);
+    }
+    double integration = secondsSince(start);
+    
+    //Trajectories of cohorts and variants
+    if (copy){
+        for (int i = 0; i <= nsims; i++){
+            for (int v = 0; v < nvariants; v++){
+                for (int j = 0; j < nind; j++){
+                    ModelFFM(v*nind + j,i) = solved[2*v](position[cohort[j]],i);
+                    ModelFM(v*nind + j,i)  = solved[2*v + 1](position[cohort[j]],i);
+                }
+            }
+        }
+    }
+    
+    //Time, age and weight
+    for (int i = 0; i <= nsims; i++){
+        TIME(i) = i*dt;
+        for (int j = 0; j < nrow; j++){
+            AGE(j,i)     = age(j % nind) + TIME(i)/365.0;
+            ModelBW(j,i) = ModelFFM(j,i) + ModelFM(j,i);
+        }
+    }
+    
+    List out_list = List::create(Named("Time") = TIME,
+                                 Named("Age") = AGE,
+                                 Named("Fat_Free_Mass") = ModelFFM,
+                                 Named("Fat_Mass") = ModelFM,
+                                 Named("Body_Weight") = ModelBW,
+                                 Named("Correct_Values")=stats.correct,
+                                 Named("Model_Type")="Children",
+                                 Named("Reference_Children")=nreference);
+    
+    //Growth function of each row
+    if (nvariants > 1){
+        CharacterVector variants(nrow);
+        for (int j = 0; j < nrow; j++){
+            variants(j) = (j < nind) ? "dynamic" : "impact";
+        }
+        out_list.push_back(variants, "Growth");
+    }
+    
+    //Add allocations if requested
+    if (allocations){
+        out_list.push_back(allocationReport(stats, setup, integration), "Allocations");
+    }
+    
+    return out_list;
+}
+
+//Regression of weight change since baseline on covariates at output steps of
+//design (see regression.h) without keeping trajectories
+List Child::regression(double days, std::string method, int nthreads, List design, int growth){
+    
+    int nsims = floor(days/dt);
+    
+    bool correct;
+    ChildModel model = nativeModel();
+    model.variant    = growth;
+    List sums = solveRegression(model, dt, nsims, method, nthreads, design, correct);
+    
+    return List::create(Named("Regression") = sums,
+                        Named("Correct_Values") = correct,
+                        Named("Model_Type") = "Children");
+}
+
+//Poisson bootstrap of mean weight of groups at output steps of design (see
+//bootstrap.h) without keeping trajectories
+List Child::bootstrap(double days, std::string method, int nthreads, List design, int growth){
+    
+    int nsims = floor(days/dt);
+    
+    bool correct;
+    ChildModel model = nativeModel();
+    model.variant    = growth;
+    List sums = solveBootstrap(model, dt, nsims, method, nthreads, design, correct);
+    
+    return List::create(Named("Bootstrap") = sums,
+                        Named("Correct_Values") = correct,
+                        Named("Model_Type") = "Children");
+}
+
+//Copy of parameters into native kernel
+ChildModel Child::nativeModel(void){
+    
+    ChildModel model;
+    
+    model.FFM      = std::vector<double>(FFM.begin(), FFM.end());
+    model.FM       = std::vector<double>(FM.begin(), FM.end());
+    model.age      = std::vector<double>(age.begin(), age.end());
+    model.setConstants(sex.begin(), nind);
+    
+    //Constants
+    model.variant  = CHILD_GROWTH_DYNAMIC;
+    model.rhoFM    = rhoFM;
+    model.deltamin = deltamin;
+    model.P        = P;
+    model.h        = h;
+    model.dt       = dt;
+    
+    //Energy intake
+    model.generalized_logistic = generalized_logistic;
+    model.K_logistic  = K_logistic;
+    model.Q_logistic  = Q_logistic;
+    model.A_logistic  = A_logistic;
+    model.B_logistic  = B_logistic;
+    model.nu_logistic = nu_logistic;
+    model.C_logistic  = C_logistic;
+    if (!generalized_logistic){
+        model.EIntake = EIntake.view();
+    }
+    
+    //Reference tables at each age from 2 to 18
+    model.FFMref.resize(((size_t) nind)*CHILD_REFERENCE_AGES);
+    model.FMref.resize(((size_t) nind)*CHILD_REFERENCE_AGES);
+    for (int i = 0; i < nind; i++){
+        for (int a = 0; a < CHILD_REFERENCE_AGES; a++){
+            model.FFMref[((size_t) i)*CHILD_REFERENCE_AGES + a] = childReference(CHILD_FFM_REFERENCE, referenceValues, sex(i), bmiCat(i), a);
+            model.FMref[((size_t) i)*CHILD_REFERENCE_AGES + a]  = childReference(CHILD_FM_REFERENCE, referenceValues, sex(i), bmiCat(i), a);
+        }
+    }
+    
+    return model;
+}
+
 NumericMatrix  Child::dMass (NumericVector t, NumericVector FFM, NumericVector FM){
     
     NumericMatrix Mass(2, nind); //in rcpp;
@@ -457,7 +655,7 @@ NumericVector Child::Intake(NumericVector t){
         return A_logistic + (K_logistic - A_logistic)/pow(C_logistic + Q_logistic*exp(-B_logistic*t), 1/nu_logistic); //t in years
     } else {
         int timeval = floor(365.0*(t(0) - age(0))/dt); //Example: Age: 6 and t: 7.1 => timeval = 401 which corresponds to the 401 entry of matrix
-        return EIntake(timeval,_);
+        return EIntake.row(timeval);
     }
     
 }
@@ -32,6 +32,8 @@
 
 #include <math.h>
 #include <Rcpp.h>
+#include "input_matrix.h"
+#include "child_model.h"
 using namespace Rcpp;
 
 //Create a Adult class to contain individual parameters
@@ -40,9 +42,9 @@ class Child {
 public:
     
     //Constructor and destroyer
-    Child(NumericVector input_age, NumericVector input_sex, NumericVector input_bmiCat, NumericVector input_FFM, NumericVector input_FM, NumericMatrix input_EIntake, double input_dt, bool checkValues, double input_referenceValues);
+    Child(NumericVector input_age, NumericVector input_sex, NumericVector input_bmiCat, NumericVector input_FFM, NumericVector input_FM, InputMatrix input_EIntake, double input_dt, bool checkValues, double input_referenceValues, bool input_allocations = false);
     Child(NumericVector input_age, NumericVector input_sex,  NumericVector input_bmiCat, NumericVector input_FFM, NumericVector input_FM,  double input_K, double input_Q, double input_A, double input_B, double input_nu, double input_C,
-          double input_dt, bool checkValues, double input_referenceValues);
+          double input_dt, bool checkValues, double input_referenceValues, bool input_allocations = false);
     
     ~Child(void);
     
@@ -52,13 +54,19 @@ public:
     NumericVector bmiCat;  // From 1 to 4: Underweight, normal, overweight and obese
     NumericVector FFM;  //Fat Free Mass (kg)
     NumericVector FM;   //Fat Mass (kg)
-    NumericMatrix EIntake;
+    InputMatrix   EIntake; //Energy intake (held by R or memory mapped)
     bool          check; // Check values are correct
     double referenceValues; //
+    bool          allocations; //Report allocations (opt-in)
     
     //Functions
     //---------------------------------------------------------------------------
     List rk4(double days);
+    List solve(double days, std::string method, int nthreads, NumericVector reference = NumericVector(0), std::string output = "",
+               int growth = CHILD_GROWTH_DYNAMIC); //Native engine (ode_engine.h)
+    List regression(double days, std::string method, int nthreads, List design, int growth = CHILD_GROWTH_DYNAMIC); //Regression of weight change (regression.h)
+    List bootstrap(double days, std::string method, int nthreads, List design, int growth = CHILD_GROWTH_DYNAMIC); //Bootstrap of mean weight (bootstrap.h)
+    ChildModel nativeModel(void);
     
     //Reference functions for reference children
     NumericVector IntakeReference(NumericVector t);
@@ -19,6 +19,8 @@
 //  B               .-  Richardson parameter
 //  nu              .-  Richardson parameter
 //  C               .-  Richardson parameter
+//  reference       .-  1 = reference child, 0 = not and NA = detect (native engine)
+//  output          .-  Directory of result files ("" to keep results in memory)
 //  Note:
 //  Weight = FFM + FM. No extracellular fluid or glycogen is considered
 //  Please see child_weight.hpp for additional information
@@ -76,24 +78,44 @@
 #include "child_weight.h"
 
 // [[Rcpp::export]]
-List child_weight_wrapper(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, NumericMatrix input_EIntake, double days, double dt, bool checkValues, double referenceValues){
+List child_weight_wrapper(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, SEXP input_EIntake, double days, double dt, bool checkValues, double referenceValues, bool allocations, std::string method, int nthreads, NumericVector reference, int growth, std::string output, SEXP regression, SEXP bootstrap){
     
     //Create new adult with characteristics
-    Child Person (age,  sex, bmiCat, FFM, FM, input_EIntake, dt, checkValues, referenceValues);
+    Child Person (age,  sex, bmiCat, FFM, FM, input_EIntake, dt, checkValues, referenceValues, allocations);
     
-    //Run model using RK4
-    return Person.rk4(days - 1); //days - 1 to account for extra day (c++ indexing starts in 0; R in 1)
+    //Run model using RK4 or native engine
+    //days - 1 to account for extra day (c++ indexing starts in 0; R in 1)
+    if (!Rf_isNull(regression)){
+        return Person.regression(days - 1, method, nthreads, List(regression), growth);
+    }
+    if (!Rf_isNull(bootstrap)){
+        return Person.bootstrap(days - 1, method, nthreads, List(bootstrap), growth);
+    }
+    if (method == "legacy"){
+        return Person.rk4(days - 1);
+    }
+    return Person.solve(days - 1, method, nthreads, reference, output, growth);
     
 }
 
 // [[Rcpp::export]]
-List child_weight_wrapper_richardson(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, double K, double Q, double A, double B, double nu, double C, double days, double dt, bool checkValues, double referenceValues){
+List child_weight_wrapper_richardson(NumericVector age, NumericVector sex, NumericVector bmiCat, NumericVector FFM, NumericVector FM, double K, double Q, double A, double B, double nu, double C, double days, double dt, bool checkValues, double referenceValues, bool allocations, std::string method, int nthreads, NumericVector reference, int growth, std::string output, SEXP regression, SEXP bootstrap){
     
     //Create new adult with characteristics
-    Child Person (age,  sex, bmiCat, FFM, FM, K, Q, A, B, nu, C, dt, checkValues, referenceValues);
+    Child Person (age,  sex, bmiCat, FFM, FM, K, Q, A, B, nu, C, dt, checkValues, referenceValues, allocations);
     
-    //Run model using RK4
-    return Person.rk4(days - 1); //days - 1 to account for extra day (c++ indexing starts in 0; R in 1)
+    //Run model using RK4 or native engine
+    //days - 1 to account for extra day (c++ indexing starts in 0; R in 1)
+    if (!Rf_isNull(regression)){
+        return Person.regression(days - 1, method, nthreads, List(regression), growth);
+    }
+    if (!Rf_isNull(bootstrap)){
+        return Person.bootstrap(days - 1, method, nthreads, List(bootstrap), growth);
+    }
+    if (method == "legacy"){
+        return Person.rk4(days - 1);
+    }
+    return Person.solve(days - 1, method, nthreads, reference, output, growth);
     
 }
 
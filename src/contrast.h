@@ -0,0 +1,91 @@
+//
+//  contrast.h
+//
+//  This is a function that runs the baseline and the scenario of a population
+//  in the native engine with a ContrastSink (contrast_sink.h) and returns the
+//  sums of their paired difference to R. Used by Adult::contrast.
+//
+//  Variables:
+//  design          .-  List with groups, weights, strata, PSUs, threshold
+//                      and output steps of each individual
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef contrast_h
+#define contrast_h
+
+#include <Rcpp.h>
+#include "ode_engine.h"
+#include "contrast_sink.h"
+using namespace Rcpp;
+
+//Design of contrast of n individuals with the R vectors it points to (model_contrast.cpp)
+class ContrastInput {
+public:
+    ContrastInput(List input_design, int n);
+    ContrastDesign design;
+private:
+    IntegerVector group;
+    IntegerVector strata;
+    IntegerVector psu;
+    NumericVector weights;
+    NumericVector threshold;
+};
+
+//Sums of contrast as R arrays (model_contrast.cpp)
+List contrastList(const ContrastSums& sums);
+
+template <class Model>
+List solveContrast(const Model& model, double dt, int nsims, std::string method,
+                   int nthreads, List design, bool& correct){
+    
+    IntegerVector steps = design["steps"];
+    int           ndays = steps.size();
+    if (model.size() % 2 != 0){
+        stop("Contrast must run a baseline and a scenario of each individual.");
+    }
+    int npairs = model.size()/2;
+    ContrastInput input(design, npairs);
+    for (int d = 0; d < ndays; d++){
+        if (steps[d] < 0 || steps[d] > nsims){
+            stop("Contrast days must be between 0 and the days of the model.");
+        }
+    }
+    if (ndays == 0 || npairs == 0){
+        stop("Contrast has no days or individuals.");
+    }
+    
+    //Run keeping only body weight at output days of both
+    std::vector<double> base(((size_t) npairs)*ndays);
+    std::vector<double> scen(((size_t) npairs)*ndays);
+    ContrastSink<Model> sink(model, npairs, std::vector<int>(steps.begin(), steps.end()),
+                             &base[0], &scen[0]);
+    EngineStats stats = solveModel(model, dt, nsims, method, nthreads, sink);
+    correct = stats.correct;
+    
+    std::vector<int> cols(ndays);
+    for (int d = 0; d < ndays; d++) cols[d] = d;
+    return contrastList(contrastSums(input.design, &base[0], &scen[0], npairs, cols));
+}
+
+#endif /* contrast_h */
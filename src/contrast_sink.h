@@ -0,0 +1,259 @@
+//
+//  contrast_sink.h
+//
+//  This is a function that defines the sums of the estimator of the paired
+//  difference between a scenario and a baseline of the same individuals
+//  (weighted mean of scenario minus baseline body weight, or of the
+//  indicators of body weight above a threshold, per group and output day)
+//  with the design-based (linearized) variance of a stratified cluster
+//  sample, and a sink of the native engine (see ode_engine.h) that runs
+//  both at the same time.
+//
+//  Variables:
+//  group           .-  Group of each individual (-1 for none)
+//  w               .-  Weight of each individual
+//  stratum         .-  Stratum of each individual
+//  psu             .-  Primary sampling unit of each individual (nested in strata)
+//  threshold       .-  Body weight whose prevalence is estimated (NULL for the mean)
+//
+//  With PSU totals a_c = sum w (ys - yb) and b_c = sum w of group g the
+//  difference is D = sum a_c/sum b_c and its variance
+//
+//      sum_h N_h/(N_h - 1) sum_c (z_c - mean_h z)^2,   z_c = (a_c - D b_c)/sum b_c
+//
+//  with N_h the PSUs of stratum h. The sums of a_c, b_c and their squares and
+//  products by stratum, group and day give the variance for any D so that
+//  sums of chunks of a population (that do not split PSUs) are added before
+//  the estimates (see model_contrast.R).
+//
+//  The sink runs 2n individuals: baseline of individual i in row i and its
+//  scenario in row n + i. It keeps only their body weight at the output days
+//  (blocks write into disjoint rows) and not their trajectories.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef contrast_sink_h
+#define contrast_sink_h
+
+#include <vector>
+#include <stdexcept>
+
+//Design of the contrast (one value per individual)
+//--------------------------------------------------------------------------------
+struct ContrastDesign {
+    int           n;         //Individuals
+    int           ngroups;   //Groups
+    int           nstrata;   //Strata
+    int           npsu;      //Primary sampling units
+    const int*    group;     //Group (0 to ngroups - 1 or -1 for none)
+    const double* w;         //Weight
+    const int*    stratum;   //Stratum (0 to nstrata - 1)
+    const int*    psu;       //PSU (0 to npsu - 1)
+    const double* threshold; //Threshold of prevalence (NULL for the mean)
+};
+
+//Sums of the contrast (by column as R arrays)
+//--------------------------------------------------------------------------------
+struct ContrastSums {
+
+    int nstrata; //Strata
+    int ngroups; //Groups
+    int ndays;   //Output days
+
+    std::vector<double> N;  //PSUs per stratum                                   (nstrata)
+    std::vector<double> B;  //sum of b_c per stratum and group                   (nstrata x ngroups)
+    std::vector<double> BB; //sum of b_c^2 per stratum and group                 (nstrata x ngroups)
+    std::vector<double> A;  //sum of a_c per stratum, group and day              (nstrata x ngroups x ndays)
+    std::vector<double> AA; //sum of a_c^2 per stratum, group and day            (nstrata x ngroups x ndays)
+    std::vector<double> AB; //sum of a_c b_c per stratum, group and day          (nstrata x ngroups x ndays)
+    std::vector<double> Y;  //sum of w yb (baseline) per stratum, group and day  (nstrata x ngroups x ndays)
+
+    ContrastSums(void){
+        nstrata = 0;
+        ngroups = 0;
+        ndays   = 0;
+    }
+
+    void resize(int input_nstrata, int input_ngroups, int input_ndays){
+        nstrata = input_nstrata;
+        ngroups = input_ngroups;
+        ndays   = input_ndays;
+        size_t cells = ((size_t) nstrata)*ngroups;
+        N.assign(nstrata, 0.0);
+        B.assign(cells, 0.0);
+        BB.assign(cells, 0.0);
+        A.assign(cells*ndays, 0.0);
+        AA.assign(cells*ndays, 0.0);
+        AB.assign(cells*ndays, 0.0);
+        Y.assign(cells*ndays, 0.0);
+    }
+};
+
+//Sums of the paired values of the individuals of design: value of individual i
+//at day d is base[i + cols[d]*nrow] in baseline and scen[i + cols[d]*nrow] in
+//scenario (either nind x ntimes matrices of models or the buffers of the sink)
+//--------------------------------------------------------------------------------
+inline ContrastSums contrastSums(const ContrastDesign& design, const double* base, const double* scen,
+                                 int nrow, const std::vector<int>& cols){
+
+    const int n       = design.n;
+    const int ngroups = design.ngroups;
+    const int nstrata = design.nstrata;
+    const int ndays   = cols.size();
+
+    ContrastSums sums;
+    sums.resize(nstrata, ngroups, ndays);
+
+    //Stratum of each PSU (PSUs are counted in N even without individuals of a group)
+    std::vector<int> stratum(design.npsu, -1);
+    for (int i = 0; i < n; i++){
+        int p = design.psu[i];
+        int h = design.stratum[i];
+        if (p < 0 || p >= design.npsu || h < 0 || h >= nstrata){
+            throw std::invalid_argument("Invalid strata or PSUs of contrast.");
+        }
+        if (design.group[i] < -1 || design.group[i] >= ngroups){
+            throw std::invalid_argument("Invalid group of contrast.");
+        }
+        if (stratum[p] < 0){
+            stratum[p] = h;
+            sums.N[h] += 1.0;
+        } else if (stratum[p] != h){
+            throw std::invalid_argument("PSUs of contrast must be nested in strata.");
+        }
+    }
+
+    //Cells of PSU and group (in order of first individual) with their b_c
+    std::vector<int>    cell(n, -1);
+    std::vector<int>    last(((size_t) design.npsu)*ngroups, -1);
+    std::vector<int>    cellStratum;
+    std::vector<int>    cellGroup;
+    std::vector<double> b;
+    for (int i = 0; i < n; i++){
+        int g = design.group[i];
+        if (g < 0) continue;
+        size_t key = ((size_t) design.psu[i])*ngroups + g;
+        if (last[key] < 0){
+            last[key] = b.size();
+            cellStratum.push_back(stratum[design.psu[i]]);
+            cellGroup.push_back(g);
+            b.push_back(0.0);
+        }
+        cell[i] = last[key];
+        b[cell[i]] += design.w[i];
+    }
+    for (size_t c = 0; c < b.size(); c++){
+        size_t k = ((size_t) cellGroup[c])*nstrata + cellStratum[c];
+        sums.B[k]  += b[c];
+        sums.BB[k] += b[c]*b[c];
+    }
+
+    //a_c of each day
+    std::vector<double> a(b.size());
+    for (int d = 0; d < ndays; d++){
+        const double* yb = base + ((size_t) cols[d])*nrow;
+        const double* ys = scen + ((size_t) cols[d])*nrow;
+        double*       Y  = &sums.Y[((size_t) d)*ngroups*nstrata];
+        a.assign(b.size(), 0.0);
+        for (int i = 0; i < n; i++){
+            if (cell[i] < 0) continue;
+            double vb = yb[i];
+            double vs = ys[i];
+            if (design.threshold){
+                vb = (vb >= design.threshold[i]) ? 1.0 : 0.0;
+                vs = (vs >= design.threshold[i]) ? 1.0 : 0.0;
+            }
+            a[cell[i]] += design.w[i]*(vs - vb);
+            Y[((size_t) design.group[i])*nstrata + design.stratum[i]] += design.w[i]*vb;
+        }
+        for (size_t c = 0; c < b.size(); c++){
+            size_t k = (((size_t) d)*ngroups + cellGroup[c])*nstrata + cellStratum[c];
+            sums.A[k]  += a[c];
+            sums.AA[k] += a[c]*a[c];
+            sums.AB[k] += a[c]*b[c];
+        }
+    }
+
+    return sums;
+}
+
+//Sink of the engine: the model has the baseline of individual i in row i and
+//its scenario in row npairs + i and gives body weight with
+//  double bodyWeight(int i, double t, const double* y, int j, int n) const;
+//Body weight at output steps is written into base and scen (npairs x ndays)
+//--------------------------------------------------------------------------------
+template <class Model>
+class ContrastSink {
+public:
+
+    ContrastSink(const Model& input_model, int input_npairs, std::vector<int> input_steps,
+                 double* input_base, double* input_scen) : model(input_model) {
+        npairs = input_npairs;
+        steps  = input_steps;
+        base   = input_base;
+        scen   = input_scen;
+    }
+
+    void begin(int nsteps, int nind, int nstates){
+        if (nind != 2*npairs){
+            throw std::invalid_argument("Contrast must run a baseline and a scenario of each individual.");
+        }
+        index.assign(nsteps + 1, -1);
+        for (size_t d = 0; d < steps.size(); d++){
+            if (steps[d] >= 0 && steps[d] <= nsteps) index[steps[d]] = d;
+        }
+    }
+
+    ContrastSink fork(void){
+        return *this;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+        int d = index[step];
+        if (d < 0) return;
+        double* yb = base + ((size_t) d)*npairs;
+        double* ys = scen + ((size_t) d)*npairs;
+        for (int j = 0; j < n; j++){
+            int i = first + j;
+            if (i < npairs){
+                yb[i] = model.bodyWeight(i, t, y, j, n);
+            } else {
+                ys[i - npairs] = model.bodyWeight(i, t, y, j, n);
+            }
+        }
+    }
+
+    void join(const ContrastSink& local){}
+    void end(void){}
+
+private:
+
+    const Model&     model;
+    int              npairs;
+    std::vector<int> steps;
+    std::vector<int> index; //Output day of each step (-1 for none)
+    double*          base;
+    double*          scen;
+};
+
+#endif /* contrast_sink_h */
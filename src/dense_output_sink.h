@@ -0,0 +1,231 @@
+//
+//  dense_output_sink.h
+//
+//  This is a function that defines a sink of the native engine (see
+//  ode_engine.h) that adds to the outputs at output days of a WindowSink
+//  (window_sink.h) their time derivatives, for cubic Hermite interpolation
+//  between output days (see model_query.R), and the exact outputs at queried
+//  (individual, day) pairs, without keeping trajectories.
+//
+//  Variables:
+//  deriv           .-  Derivatives of outputs (nind x ndays matrices by column as in R)
+//  individual      .-  Individual of each query (from 0)
+//  day             .-  Day of each query
+//  query           .-  Outputs of queries (nquery vectors)
+//
+//  The derivative of output v at the state y of an output day is the central
+//  difference along the derivative f of the states:
+//
+//      dv/dt = (v(y + e f) - v(y - e f))/(2 e)
+//
+//  which is exact for outputs linear in the states (outputs that change only
+//  with time, as intake, have derivative 0). A query at day s*dt + r (with
+//  0 <= r < dt) re-integrates its individual from the state at step s with a
+//  step of RK4 of length r. Queries are sorted by individual and day so each
+//  block only looks at the next query of each of its individuals.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef dense_output_sink_h
+#define dense_output_sink_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "ode_integrators.h"
+#include "window_sink.h"
+
+//Sink of the engine: the model gives its outputs as for WindowSink
+//--------------------------------------------------------------------------------
+template <class Model>
+class DenseOutputSink {
+public:
+
+    DenseOutputSink(const Model& input_model, const WindowSink<Model>& input_window,
+                    std::vector<int> input_steps, double input_dt) :
+        model(input_model), window(input_window) {
+        steps      = input_steps;
+        dt         = input_dt;
+        eps        = 1e-4;
+        nind       = 0;
+        individual = NULL;
+        day        = NULL;
+        nquery     = 0;
+    }
+
+    //Derivatives of the first deriv.size() outputs at output days (nind x ndays)
+    void derivatives(std::vector<double*> input_deriv){
+        if (input_deriv.size() > (size_t) Model::noutputs){
+            throw std::invalid_argument("Invalid derivatives of model.");
+        }
+        deriv = input_deriv;
+    }
+
+    //Outputs of queries (individual from 0 and day) into query (nquery each)
+    void queries(const int* input_individual, const double* input_day, int input_nquery,
+                 std::vector<double*> input_query){
+        if (input_query.size() > (size_t) Model::noutputs){
+            throw std::invalid_argument("Invalid queries of model.");
+        }
+        individual = input_individual;
+        day        = input_day;
+        nquery     = input_nquery;
+        query      = input_query;
+    }
+
+    void begin(int nsteps, int input_nind, int nstates){
+
+        nind = input_nind;
+        window.begin(nsteps, nind, nstates);
+        rk4.resize(Model::nstates);
+
+        //Output days of each step (as CSR)
+        dstart.assign(nsteps + 2, 0);
+        for (size_t d = 0; d < steps.size(); d++){
+            if (steps[d] >= 0 && steps[d] <= nsteps) dstart[steps[d] + 1]++;
+        }
+        for (int s = 0; s <= nsteps; s++) dstart[s + 1] += dstart[s];
+        std::vector<int> count = dstart;
+        outday.resize(dstart[nsteps + 1]);
+        for (size_t d = 0; d < steps.size(); d++){
+            if (steps[d] >= 0 && steps[d] <= nsteps) outday[count[steps[d]]++] = d;
+        }
+
+        //Queries of each individual sorted by day (as CSR) with their step
+        qstart.assign(nind + 1, 0);
+        qstep.resize(nquery);
+        for (int q = 0; q < nquery; q++){
+            if (individual[q] < 0 || individual[q] >= nind){
+                throw std::invalid_argument("Invalid individual of query.");
+            }
+            qstep[q] = (int) std::floor(day[q]/dt + 1e-9);
+            if (qstep[q] < 0 || qstep[q] > nsteps || (qstep[q] == nsteps && day[q] > nsteps*dt + 1e-9*dt)){
+                throw std::invalid_argument("Query days must be between 0 and the days of the model.");
+            }
+            qstart[individual[q] + 1]++;
+        }
+        for (int i = 0; i < nind; i++) qstart[i + 1] += qstart[i];
+        count = qstart;
+        qorder.resize(nquery);
+        for (int q = 0; q < nquery; q++) qorder[count[individual[q]]++] = q;
+        for (int i = 0; i < nind; i++){
+            std::stable_sort(qorder.begin() + qstart[i], qorder.begin() + qstart[i + 1], ByDay(day));
+        }
+    }
+
+    //Blocks write into disjoint rows of the same matrices (and queries of
+    //their individuals) as the WindowSink
+    DenseOutputSink fork(void){
+        return *this;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+
+        window.write(step, t, y, first, n);
+
+        //Workspace of derivatives of the block (at its first step)
+        const int nvalues = Model::nstates*n;
+        if (step == 0 && !deriv.empty()){
+            f.resize(nvalues);
+            yp.resize(nvalues);
+            ym.resize(nvalues);
+        }
+
+        //Derivatives at output days
+        if (!deriv.empty() && dstart[step] < dstart[step + 1]){
+            model.derivatives(t, y, &f[0], first, n);
+            for (int k = 0; k < nvalues; k++){
+                yp[k] = y[k] + eps*f[k];
+                ym[k] = y[k] - eps*f[k];
+            }
+            double vp[Model::noutputs];
+            double vm[Model::noutputs];
+            for (int j = 0; j < n; j++){
+                model.outputs(first + j, t, &yp[0], j, n, vp);
+                model.outputs(first + j, t, &ym[0], j, n, vm);
+                for (int e = dstart[step]; e < dstart[step + 1]; e++){
+                    size_t index = ((size_t) outday[e])*nind + first + j;
+                    for (size_t k = 0; k < deriv.size(); k++){
+                        deriv[k][index] = (vp[k] - vm[k])/(2.0*eps);
+                    }
+                }
+            }
+        }
+
+        //Queries from the state of their step
+        if (nquery == 0) return;
+        if (step == 0) next.assign(qstart.begin() + first, qstart.begin() + first + n);
+        for (int j = 0; j < n; j++){
+            int i = first + j;
+            for (; next[j] < qstart[i + 1] && qstep[qorder[next[j]]] == step; next[j]++){
+                int    q = qorder[next[j]];
+                double r = day[q] - step*dt;
+                double v[Model::noutputs];
+                if (r <= 1e-9*dt){
+                    model.outputs(i, t, y, j, n, v);
+                } else {
+                    double yi[Model::nstates];
+                    for (int k = 0; k < Model::nstates; k++) yi[k] = y[k*n + j];
+                    rk4.advance(model, t, r, yi, i, 1);
+                    model.outputs(i, t + r, yi, 0, 1, v);
+                }
+                for (size_t k = 0; k < query.size(); k++) query[k][q] = v[k];
+            }
+        }
+    }
+
+    void join(const DenseOutputSink& local){}
+    void end(void){}
+
+private:
+
+    //Order of queries by day
+    struct ByDay {
+        const double* day;
+        ByDay(const double* input_day) : day(input_day) {}
+        bool operator()(int a, int b) const { return day[a] < day[b]; }
+    };
+
+    const Model&         model;
+    WindowSink<Model>    window;
+    std::vector<int>     steps;
+    double               dt;
+    double               eps;    //Days of central difference
+    int                  nind;
+    std::vector<double*> deriv;
+    std::vector<int>     dstart; //Output days of step s are outday[dstart[s]], ..., outday[dstart[s + 1] - 1]
+    std::vector<int>     outday;
+    WorkVector           f, yp, ym;
+    const int*           individual;
+    const double*        day;
+    int                  nquery;
+    std::vector<double*> query;
+    std::vector<int>     qstart; //Queries of individual i are qorder[qstart[i]], ..., qorder[qstart[i + 1] - 1]
+    std::vector<int>     qorder;
+    std::vector<int>     qstep;  //Step of each query
+    WorkIndex            next;   //Next query of each individual of block
+    RK4<Model>           rk4;
+};
+
+#endif /* dense_output_sink_h */
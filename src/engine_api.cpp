@@ -0,0 +1,455 @@
+//
+//  engine_api.cpp
+//
+//  This is a function that implements the C interface of engine_api.h: the
+//  adult and children kernels (adult_model.h and child_model.h) are built from
+//  the arrays of the caller with the same parameters as Adult and Child
+//  (adult_weight.cpp and child_weight.cpp) and solved with the native engine
+//  into the arrays of the caller. Nothing here depends on R.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "engine_api.h"
+#include "adult_model.h"
+#include "child_model.h"
+#include "ode_engine.h"
+#include "regression_sink.h"
+#include "bootstrap_sink.h"
+
+//View of input of caller
+static InputView inputView(const bw_input& input, int ncol){
+    InputView view;
+    if (input.values == NULL || input.nrow < 1){
+        throw std::invalid_argument("Inputs of the model must have at least one time.");
+    }
+    if (input.type == 1){
+        view.values  = (const double*) input.values;
+    } else if (input.type == 2){
+        view.fvalues = (const float*) input.values;
+    } else {
+        throw std::invalid_argument("Invalid type of input. Please choose 1 (double) or 2 (float).");
+    }
+    view.rowstride = input.rowstride;
+    view.colstride = input.colstride;
+    view.nrow      = input.nrow;
+    view.ncol      = ncol;
+    return view;
+}
+
+//Message of exception into error of caller
+static int apiError(const std::exception& e, char* error, int nerror){
+    if (error != NULL && nerror > 0){
+        std::strncpy(error, e.what(), nerror - 1);
+        error[nerror - 1] = '\0';
+    }
+    return 1;
+}
+
+//Adult kernel with the parameters of Adult::build (adult_weight.cpp)
+//--------------------------------------------------------------------------------
+static AdultModel adultModel(const bw_adult& adult, int nthreads){
+
+    int nind = adult.nind;
+    if (nind < 1 || adult.bw == NULL || adult.ht == NULL || adult.age == NULL ||
+        adult.sex == NULL || adult.pcarb_base == NULL || adult.pcarb == NULL){
+        throw std::invalid_argument("Adults need bw, ht, age, sex, pcarb_base and pcarb.");
+    }
+
+    AdultModel model;
+    model.EIchange = inputView(adult.EIchange, nind);
+    model.NAchange = inputView(adult.NAchange, nind);
+    model.PAL      = inputView(adult.PAL, nind);
+
+    //Constants (Adult::getParameters)
+    model.roG     = 4206.501;
+    model.Na      = 3220;
+    model.zetaNa  = 3000;
+    model.zetaCI  = 4000;
+    model.roF     = 9440.727;
+    model.roL     = 1816.444;
+    model.gammaF  = 3.107075;
+    model.gammaL  = 21.98853;
+    model.etaF    = 179.2543;
+    model.etaL    = 229.4455;
+    model.betaTEF = 0.1;
+    model.betaAT  = 0.14;
+    model.tauAT   = 14.0;
+    model.C       = 10.4*(model.roL/model.roF);
+    model.alfa1   = -(1 + model.etaL/model.roL)*model.C;
+    model.alfa2   = -(1 + model.etaF/model.roF);
+    model.dt      = 0.0;
+
+    //Individuals and constants at baseline (Adult::build) in one pass over blocks
+    AdultArrays in = {adult.bw, adult.ht, adult.age, adult.sex, adult.pcarb_base, adult.pcarb,
+                      adult.EI, adult.fat};
+    model.resizeBaseline(nind);
+    forBlocks(nind, nthreads, [&](int first, int n){
+        model.baseline(in, first, n);
+    });
+
+    return model;
+}
+
+//Child kernel with the parameters of Child::getParameters (child_weight.cpp)
+//--------------------------------------------------------------------------------
+static ChildModel childModel(const bw_child& child, bool intake){
+
+    int nind = child.nind;
+    if (nind < 1 || child.age == NULL || child.sex == NULL || child.bmiCat == NULL){
+        throw std::invalid_argument("Children need age, sex and bmiCat.");
+    }
+    if (intake && (child.FFM == NULL || child.FM == NULL)){
+        throw std::invalid_argument("Children need FFM and FM.");
+    }
+
+    ChildModel model;
+    model.generalized_logistic = false;
+    model.K_logistic  = 0.0;
+    model.Q_logistic  = 0.0;
+    model.A_logistic  = 0.0;
+    model.B_logistic  = 0.0;
+    model.nu_logistic = 0.0;
+    model.C_logistic  = 0.0;
+    if (intake){
+        model.EIntake = inputView(child.EI, nind);
+    }
+
+    //Constants
+    model.rhoFM    = 9.4*1000.0;
+    model.deltamin = 10.0;
+    model.P        = 12.0;
+    model.h        = 10.0;
+    model.dt       = 0.0;
+    model.variant  = CHILD_GROWTH_DYNAMIC;
+
+    model.age.assign(child.age, child.age + nind);
+    if (intake){
+        model.FFM.assign(child.FFM, child.FFM + nind);
+        model.FM.assign(child.FM, child.FM + nind);
+    }
+
+    //Sex specific constants (ChildConstants in child_model.h) and reference
+    model.setConstants(child.sex, nind);
+    model.FFMref.resize(((size_t) nind)*CHILD_REFERENCE_AGES);
+    model.FMref.resize(((size_t) nind)*CHILD_REFERENCE_AGES);
+    for (int i = 0; i < nind; i++){
+        double sex = child.sex[i];
+        for (int a = 0; a < CHILD_REFERENCE_AGES; a++){
+            model.FFMref[((size_t) i)*CHILD_REFERENCE_AGES + a] = childReference(CHILD_FFM_REFERENCE, child.referenceValues, sex, child.bmiCat[i], a);
+            model.FMref[((size_t) i)*CHILD_REFERENCE_AGES + a]  = childReference(CHILD_FM_REFERENCE, child.referenceValues, sex, child.bmiCat[i], a);
+        }
+    }
+
+    return model;
+}
+
+//Checks of options and designs
+//--------------------------------------------------------------------------------
+static void checkOptions(const bw_options& options){
+    if (options.dt <= 0 || options.nsteps < 0 || options.nthreads < 0 || options.method == NULL){
+        throw std::invalid_argument("Invalid options. Please choose dt > 0, nsteps >= 0, threads >= 0 and a method.");
+    }
+}
+
+static std::vector<int> checkSteps(const int* steps, int ndays, int nsteps){
+    if (ndays < 1 || steps == NULL){
+        throw std::invalid_argument("Designs need at least one output day.");
+    }
+    for (int d = 0; d < ndays; d++){
+        if (steps[d] < 0 || steps[d] > nsteps){
+            throw std::invalid_argument("Output days must be between 0 and the days of the model.");
+        }
+    }
+    return std::vector<int>(steps, steps + ndays);
+}
+
+//Bootstrap and regression of any model (as bootstrap.h and regression.h)
+template <class Model>
+static void solveBootstrap(const Model& model, bw_options& options, bw_bootstrap& design){
+
+    std::vector<int> steps = checkSteps(design.steps, design.ndays, options.nsteps);
+    if (design.group == NULL || design.weights == NULL || design.ids == NULL || design.replicates < 1){
+        throw std::invalid_argument("Bootstrap needs groups, weights, ids and replicates >= 1.");
+    }
+    for (int i = 0; i < model.size(); i++){
+        if (design.group[i] < 0 || design.group[i] >= design.ngroups){
+            throw std::invalid_argument("Invalid group of bootstrap.");
+        }
+    }
+
+    BootstrapSink<Model> sink(model, design.group, design.weights, design.ids, design.ngroups,
+                              design.replicates, design.seed, steps);
+    EngineStats stats = solveModel(model, options.dt, options.nsteps, options.method, options.nthreads, sink);
+    options.correct = stats.correct;
+
+    const BootstrapSums& sums = sink.sums;
+    std::copy(sums.W.begin(), sums.W.end(), design.W);
+    std::copy(sums.S.begin(), sums.S.end(), design.S);
+    std::copy(sums.WB.begin(), sums.WB.end(), design.WB);
+    std::copy(sums.SB.begin(), sums.SB.end(), design.SB);
+}
+
+template <class Model>
+static void solveRegression(const Model& model, bw_options& options, bw_regression& design){
+
+    std::vector<int> steps = checkSteps(design.steps, design.ndays, options.nsteps);
+    if (design.X == NULL || design.weights == NULL || design.p < 1){
+        throw std::invalid_argument("Regression needs covariates and weights.");
+    }
+
+    RegressionSink<Model> sink(model, design.X, design.weights, design.p, steps);
+    EngineStats stats = solveModel(model, options.dt, options.nsteps, options.method, options.nthreads, sink);
+    options.correct = stats.correct;
+
+    const RegressionSums& sums = sink.sums;
+    *design.N  = sums.n;
+    *design.sw = sums.sw;
+    std::copy(sums.XtWX.begin(), sums.XtWX.end(), design.XtWX);
+    std::copy(sums.S4.begin(), sums.S4.end(), design.S4);
+    std::copy(sums.XtWy.begin(), sums.XtWy.end(), design.XtWy);
+    std::copy(sums.S2.begin(), sums.S2.end(), design.S2);
+    std::copy(sums.S3.begin(), sums.S3.end(), design.S3);
+}
+
+//Adults
+//--------------------------------------------------------------------------------
+int bw_adult_trajectories(const bw_adult* adult, bw_options* options, double* const* out,
+                          char* error, int nerror){
+    try {
+        checkOptions(*options);
+        AdultModel model = adultModel(*adult, options->nthreads);
+        model.dt  = options->dt;
+        int nind  = adult->nind;
+        int nsims = options->nsteps;
+        if (out[3] == NULL || (!options->qss && (out[1] == NULL || out[2] == NULL))){
+            throw std::invalid_argument("Adults need arrays for the states of the model.");
+        }
+
+        //Engine writes states directly into arrays of caller (Adult::solve)
+        std::vector<double> at;
+        if (out[0] == NULL){
+            at.resize(((size_t) nind)*(nsims + 1));
+        }
+        std::vector<double*> states;
+        states.push_back(out[0] != NULL ? out[0] : &at[0]);
+        EngineStats stats;
+        if (options->qss){
+            states.push_back(out[3]);
+            DenseSink sink(states);
+            stats = solveModel(AdultQSSModel(model), options->dt, nsims, options->method, options->nthreads, sink);
+        } else {
+            states.push_back(out[1]);
+            states.push_back(out[2]);
+            states.push_back(out[3]);
+            DenseSink sink(states);
+            stats = solveModel(model, options->dt, nsims, options->method, options->nthreads, sink);
+        }
+        options->correct = stats.correct;
+
+        //Variables derived from states
+        AdultQSSModel reduced(model);
+        for (int s = 0; s <= nsims; s++){
+            double t = s*options->dt;
+            for (int i = 0; i < nind; i++){
+                size_t k = ((size_t) s)*nind + i;
+                double L = out[3][k];
+                double ECF, GLY;
+                if (options->qss){
+                    ECF = (s == 0) ? model.ecfinit[i] : reduced.extracellular(i, t);
+                    GLY = (s == 0) ? model.G_base[i] : reduced.glycogen(i, t);
+                    if (out[1] != NULL) out[1][k] = ECF;
+                    if (out[2] != NULL) out[2][k] = GLY;
+                } else {
+                    ECF = out[1][k];
+                    GLY = out[2][k];
+                }
+                double F = model.fatMass(i, L);
+                if (out[4] != NULL) out[4][k] = F;
+                if (out[5] != NULL) out[5][k] = F + L + ECF + 3.7*GLY;
+                if (out[6] != NULL) out[6][k] = (s == 0) ? model.EI[i] : model.TotalIntake(i, t);
+            }
+        }
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+int bw_adult_bootstrap(const bw_adult* adult, bw_options* options, bw_bootstrap* design,
+                       char* error, int nerror){
+    try {
+        checkOptions(*options);
+        AdultModel model = adultModel(*adult, options->nthreads);
+        model.dt = options->dt;
+        if (options->qss){
+            solveBootstrap(AdultQSSModel(model), *options, *design);
+        } else {
+            solveBootstrap(model, *options, *design);
+        }
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+int bw_adult_regression(const bw_adult* adult, bw_options* options, bw_regression* design,
+                        char* error, int nerror){
+    try {
+        checkOptions(*options);
+        AdultModel model = adultModel(*adult, options->nthreads);
+        model.dt = options->dt;
+        if (options->qss){
+            solveRegression(AdultQSSModel(model), *options, *design);
+        } else {
+            solveRegression(model, *options, *design);
+        }
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+//Children
+//--------------------------------------------------------------------------------
+int bw_child_trajectories(const bw_child* child, bw_options* options, double* const* out,
+                          char* error, int nerror){
+    try {
+        checkOptions(*options);
+        ChildModel model = childModel(*child, true);
+        model.dt      = options->dt;
+        model.variant = (options->growth == CHILD_GROWTH_IMPACT) ? CHILD_GROWTH_IMPACT : CHILD_GROWTH_DYNAMIC;
+        int nind  = child->nind;
+        int nsims = options->nsteps;
+        if (out[0] == NULL || out[1] == NULL){
+            throw std::invalid_argument("Children need arrays for the states of the model.");
+        }
+
+        //Engine writes states directly into arrays of caller (Child::solve); with
+        //both growth functions the impact rows are copied after integration
+        EngineStats stats;
+        std::vector<double*> states;
+        if (options->growth == CHILD_GROWTH_BOTH){
+            std::vector<double> impact(2*((size_t) nind)*(nsims + 1));
+            std::vector<double> dynamic(2*((size_t) nind)*(nsims + 1));
+            states.push_back(&dynamic[0]);
+            states.push_back(&dynamic[0] + ((size_t) nind)*(nsims + 1));
+            states.push_back(&impact[0]);
+            states.push_back(&impact[0] + ((size_t) nind)*(nsims + 1));
+            DenseSink sink(states);
+            stats = solveModel(ChildGrowthModel(model), options->dt, nsims, options->method, options->nthreads, sink);
+            for (int s = 0; s <= nsims; s++){
+                for (int v = 0; v < 2; v++){
+                    for (int k = 0; k < 2; k++){
+                        const double* from = states[2*v + k] + ((size_t) s)*nind;
+                        std::copy(from, from + nind, out[k] + ((size_t) s)*2*nind + v*nind);
+                    }
+                }
+            }
+        } else {
+            states.push_back(out[0]);
+            states.push_back(out[1]);
+            DenseSink sink(states);
+            stats = solveModel(model, options->dt, nsims, options->method, options->nthreads, sink);
+        }
+        options->correct = stats.correct;
+
+        //Weight
+        if (out[2] != NULL){
+            size_t nvalues = ((size_t) (options->growth == CHILD_GROWTH_BOTH ? 2 : 1))*nind*(nsims + 1);
+            for (size_t k = 0; k < nvalues; k++){
+                out[2][k] = out[0][k] + out[1][k];
+            }
+        }
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+int bw_child_bootstrap(const bw_child* child, bw_options* options, bw_bootstrap* design,
+                       char* error, int nerror){
+    try {
+        checkOptions(*options);
+        if (options->growth == CHILD_GROWTH_BOTH){
+            throw std::invalid_argument("Please choose either growth = both or bootstrap.");
+        }
+        ChildModel model = childModel(*child, true);
+        model.dt      = options->dt;
+        model.variant = options->growth;
+        solveBootstrap(model, *options, *design);
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+int bw_child_regression(const bw_child* child, bw_options* options, bw_regression* design,
+                        char* error, int nerror){
+    try {
+        checkOptions(*options);
+        if (options->growth == CHILD_GROWTH_BOTH){
+            throw std::invalid_argument("Please choose either growth = both or regression.");
+        }
+        ChildModel model = childModel(*child, true);
+        model.dt      = options->dt;
+        model.variant = options->growth;
+        solveRegression(model, *options, *design);
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+int bw_child_reference(const bw_child* child, double* FFM, double* FM, char* error, int nerror){
+    try {
+        ChildModel model = childModel(*child, false);
+        for (int i = 0; i < child->nind; i++){
+            FFM[i] = model.Reference(model.FFMref, i, child->age[i]);
+            FM[i]  = model.Reference(model.FMref, i, child->age[i]);
+        }
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
+
+int bw_child_reference_EI(const bw_child* child, double dt, int nsteps, double* EI,
+                          char* error, int nerror){
+    try {
+        ChildModel model = childModel(*child, false);
+        for (int s = 0; s <= nsteps; s++){
+            for (int i = 0; i < child->nind; i++){
+                EI[((size_t) s)*child->nind + i] = model.IntakeReference(i, child->age[i] + dt*s/365.0);
+            }
+        }
+    } catch (std::exception& e){
+        return apiError(e, error, nerror);
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+//
+//  engine_api.h
+//
+//  This is a function that defines a C interface to the native engine
+//  (ode_engine.h) of the adult and children models that does not depend on R
+//  so that other languages (e.g. Python with ctypes; see inst/python) run
+//  the models on their own arrays. Inputs are read from the arrays of the
+//  caller through strides and results are written into arrays allocated by
+//  the caller: nothing is copied. Functions return 0 on success and 1 on
+//  error with the message in error (of size nerror).
+//
+//  Variables:
+//  bw_input        .-  Input of the model by time and individual (e.g. EIchange)
+//  bw_adult        .-  Adults (as adult_weight; sex 0 = male, 1 = female)
+//  bw_child        .-  Children (as child_weight; EI by time and child)
+//  bw_options      .-  Time step, steps, method, threads and model options
+//  bw_bootstrap    .-  Design and sums of bootstrap of mean weight (bootstrap_sink.h)
+//  bw_regression   .-  Design and sums of regression of weight change (regression_sink.h)
+//
+//  Trajectories are nind x (nsteps + 1) matrices by column (value of individual
+//  i at step s in out[k][i + s*nind]): adults have Adaptive_Thermogenesis,
+//  Extracellular_Fluid, Glycogen, Lean_Mass, Fat_Mass, Body_Weight and
+//  Energy_Intake (out[0], ..., out[6]) and children Fat_Free_Mass, Fat_Mass and
+//  Body_Weight (out[0], out[1], out[2]; 2*nind rows with growth = both).
+//  Entries of out may be NULL except Lean_Mass of adults (and Extracellular_Fluid
+//  and Glycogen without qss) and Fat_Free_Mass and Fat_Mass of children.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef engine_api_h
+#define engine_api_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Value (time i, individual j) at values[i*rowstride + j*colstride] (in elements)
+typedef struct {
+    const void* values;
+    int         type;       //1 = double; 2 = float (as intake files)
+    int         nrow;       //Times
+    long long   rowstride;
+    long long   colstride;
+} bw_input;
+
+typedef struct {
+    int           nind;
+    const double* bw;
+    const double* ht;
+    const double* age;
+    const double* sex;
+    const double* pcarb_base;
+    const double* pcarb;
+    const double* EI;       //Baseline energy intake (NULL for steady state)
+    const double* fat;      //Baseline fat mass (NULL for estimate)
+    bw_input      EIchange;
+    bw_input      NAchange;
+    bw_input      PAL;
+} bw_adult;
+
+typedef struct {
+    int           nind;
+    const double* age;
+    const double* sex;
+    const double* bmiCat;
+    const double* FFM;
+    const double* FM;
+    int           referenceValues; //0 = mean; 1 = median
+    bw_input      EI;
+} bw_child;
+
+typedef struct {
+    double      dt;
+    int         nsteps;
+    const char* method;   //"rk4", "rk45", "abm", "imex" or "rosenbrock"
+    int         nthreads; //0 = all cores
+    int         qss;      //Adults: quasi steady state of glycogen and fluid
+    int         growth;   //Children: 0 = dynamic, 1 = impact, 2 = both
+    int         correct;  //Set to 1 if all states are finite
+} bw_options;
+
+typedef struct {
+    const int*    group;      //Group of each individual (0, ..., ngroups - 1)
+    const double* weights;
+    const double* ids;
+    int           ngroups;
+    int           replicates;
+    double        seed;
+    const int*    steps;      //Output steps
+    int           ndays;
+    double*       W;          //ngroups
+    double*       S;          //ngroups x ndays
+    double*       WB;         //replicates x ngroups
+    double*       SB;         //replicates x ngroups x ndays
+} bw_bootstrap;
+
+typedef struct {
+    const double* X;          //nind x p covariates by column
+    const double* weights;
+    int           p;
+    const int*    steps;      //Output steps
+    int           ndays;
+    double*       N;          //1
+    double*       sw;         //1
+    double*       XtWX;       //npairs = p*(p + 1)/2
+    double*       S4;         //npairs x npairs (upper triangle by row)
+    double*       XtWy;       //p x ndays
+    double*       S2;         //npairs x ndays
+    double*       S3;         //npairs*p x ndays
+} bw_regression;
+
+int bw_adult_trajectories(const bw_adult* adult, bw_options* options, double* const* out,
+                          char* error, int nerror);
+int bw_adult_bootstrap(const bw_adult* adult, bw_options* options, bw_bootstrap* design,
+                       char* error, int nerror);
+int bw_adult_regression(const bw_adult* adult, bw_options* options, bw_regression* design,
+                        char* error, int nerror);
+int bw_child_trajectories(const bw_child* child, bw_options* options, double* const* out,
+                          char* error, int nerror);
+int bw_child_bootstrap(const bw_child* child, bw_options* options, bw_bootstrap* design,
+                       char* error, int nerror);
+int bw_child_regression(const bw_child* child, bw_options* options, bw_regression* design,
+                        char* error, int nerror);
+
+//Reference fat free and fat mass of children at their age and reference energy
+//intake (nind x (nsteps + 1) by column; as child_reference_EI)
+int bw_child_reference(const bw_child* child, double* FFM, double* FM, char* error, int nerror);
+int bw_child_reference_EI(const bw_child* child, double dt, int nsteps, double* EI,
+                          char* error, int nerror);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* engine_api_h */
@@ -0,0 +1,371 @@
+//
+//  input_matrix.cpp
+//
+//  This is a function that implements the time-major input matrices
+//  used by the weight models. Values are either held by R or read
+//  through a memory map of an intake file directly from the page cache.
+//  See input_matrix.h for the file format.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "input_matrix.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Size in bytes of each value type
+static size_t typeSize(uint32_t type){
+    if (type == 1){
+        return sizeof(double);
+    } else if (type == 2){
+        return sizeof(float);
+    }
+    stop("Invalid value type in intake file. Type must be 1 (double) or 2 (float).");
+    return 0;
+}
+
+//Map file and validate header
+MappedFile::MappedFile(std::string path){
+
+    address = NULL;
+    length  = 0;
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        stop("Unable to open intake file " + path);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    length  = (size_t) size.QuadPart;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL){
+        address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (address == NULL){
+        if (mapping != NULL) CloseHandle(mapping);
+        CloseHandle(file);
+        stop("Unable to memory map intake file " + path);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        stop("Unable to open intake file " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0){
+        close(fd);
+        stop("Unable to read intake file " + path);
+    }
+    length  = (size_t) info.st_size;
+    address = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); //Mapping remains valid after closing the descriptor
+    if (address == MAP_FAILED){
+        address = NULL;
+        stop("Unable to memory map intake file " + path);
+    }
+
+    //Rows are read in time order
+    madvise(address, length, MADV_SEQUENTIAL);
+#endif
+
+    //Validate header
+    if (length < sizeof(IntakeFileHeader)){
+        unmap();
+        stop("Invalid intake file " + path + ": file is smaller than header.");
+    }
+    std::memcpy(&header, address, sizeof(IntakeFileHeader));
+    if (std::memcmp(header.magic, "BWINTAKE", 8) != 0){
+        unmap();
+        stop("Invalid intake file " + path + ": not an intake file.");
+    }
+    if (header.version != 1 || (header.type != 1 && header.type != 2)){
+        unmap();
+        stop("Invalid intake file " + path + ": unsupported version or value type.");
+    }
+    if (length < sizeof(IntakeFileHeader) + header.ntimes*header.nind*typeSize(header.type)){
+        unmap();
+        stop("Invalid intake file " + path + ": file is truncated.");
+    }
+
+    values = static_cast<const unsigned char*>(address) + sizeof(IntakeFileHeader);
+}
+
+//Unmap on destruction
+MappedFile::~MappedFile(void){
+    unmap();
+}
+
+//Unmap
+void MappedFile::unmap(void){
+    if (address != NULL){
+#ifdef _WIN32
+        UnmapViewOfFile(address);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(address, length);
+#endif
+        address = NULL;
+    }
+}
+
+//Empty input
+InputMatrix::InputMatrix(void){
+    values = NumericMatrix(1,1);
+}
+
+//Input held by R
+InputMatrix::InputMatrix(NumericMatrix input){
+    values = input;
+}
+
+//Input from R: either a file path, a matrix or a list of the values (either
+//of them) and the columns (from 0) of a subset
+InputMatrix::InputMatrix(SEXP input){
+    if (TYPEOF(input) == VECSXP){
+        List subset = List(input);
+        SEXP whole  = subset["values"];
+        *this = InputMatrix(whole).select(as<std::vector<int> >(subset["columns"]));
+    } else if (TYPEOF(input) == STRSXP){
+        file = std::make_shared<MappedFile>(as<std::string>(input));
+    } else {
+        values = NumericMatrix(input);
+    }
+}
+
+int InputMatrix::nrow(void) const {
+    if (file){
+        return file->header.ntimes;
+    }
+    return values.nrow();
+}
+
+int InputMatrix::ncol(void) const {
+    if (columns){
+        return columns->size();
+    }
+    if (file){
+        return file->header.nind;
+    }
+    return values.ncol();
+}
+
+//Subset of individuals: columns of a subset are composed with those of this matrix
+InputMatrix InputMatrix::select(const std::vector<int>& input_columns) const {
+    InputMatrix subset = *this;
+    subset.columns = std::make_shared<std::vector<int> >(input_columns);
+    for (size_t j = 0; j < input_columns.size(); j++){
+        if (input_columns[j] < 0 || input_columns[j] >= ncol()){
+            stop("Subset out of bounds of input. Please make sure the subset is of the same population.");
+        }
+        if (columns){
+            (*subset.columns)[j] = (*columns)[input_columns[j]];
+        }
+    }
+    return subset;
+}
+
+//All individuals at time i
+NumericVector InputMatrix::row(int i){
+
+    if (columns){
+        NumericVector rowval(ncol());
+        
+        //Profiles shared by several individuals (intake_profiles) are read once and
+        //broadcast; subsets smaller than the input are read individual by individual
+        InputMatrix whole = *this;
+        whole.columns.reset();
+        if (columns->size() >= (size_t) whole.ncol()){
+            NumericVector profiles = whole.row(i);
+            for (int j = 0; j < ncol(); j++){
+                rowval(j) = profiles((*columns)[j]);
+            }
+            return rowval;
+        }
+        for (int j = 0; j < ncol(); j++){
+            rowval(j) = (*this)(i, j);
+        }
+        return rowval;
+    }
+
+    if (!file){
+        return values(i,_);
+    }
+
+    if (i < 0 || i >= nrow()){
+        stop("Time out of bounds of intake file. Please make sure the file has enough rows for days/dt.");
+    }
+
+    //Read values directly from the map
+    int nind = ncol();
+    NumericVector rowval(nind);
+    if (file->header.type == 1){
+        std::memcpy(rowval.begin(), file->values + ((size_t) i)*nind*sizeof(double), nind*sizeof(double));
+    } else {
+        const float* vals = reinterpret_cast<const float*>(file->values) + ((size_t) i)*nind;
+        for (int j = 0; j < nind; j++){
+            rowval(j) = vals[j];
+        }
+    }
+    return rowval;
+}
+
+//Individual j at time i
+double InputMatrix::operator()(int i, int j){
+    if (i < 0 || i >= nrow()){
+        stop("Time out of bounds of intake. Please make sure the intake has enough rows for days/dt.");
+    }
+    if (j < 0 || j >= ncol()){
+        stop("Individual out of bounds of intake. Please make sure the intake has a column per individual.");
+    }
+    if (columns){
+        j = (*columns)[j];
+    }
+    if (!file){
+        return values(i, j);
+    }
+    size_t nind = file->header.nind;
+    if (file->header.type == 1){
+        double val;
+        std::memcpy(&val, file->values + (((size_t) i)*nind + j)*sizeof(double), sizeof(double));
+        return val;
+    }
+    return reinterpret_cast<const float*>(file->values)[((size_t) i)*nind + j];
+}
+
+//View of values: R matrices are column major (time in rows) while
+//intake files store all individuals of each time together
+InputView InputMatrix::view(void){
+    InputView input;
+    input.nrow = nrow();
+    input.ncol = ncol();
+    if (!file){
+        input.values    = values.begin();
+        input.rowstride = 1;
+        input.colstride = values.nrow();
+    } else {
+        if (file->header.type == 1){
+            input.values  = reinterpret_cast<const double*>(file->values);
+        } else {
+            input.fvalues = reinterpret_cast<const float*>(file->values);
+        }
+        input.rowstride = file->header.nind;
+        input.colstride = 1;
+    }
+    if (columns && !columns->empty()){
+        input.columns = &(*columns)[0];
+    }
+    return input;
+}
+
+//Write intake file (timeInRows = true if each row of input is a time)
+void writeIntakeFile(NumericMatrix input, std::string path, bool timeInRows, int type){
+
+    IntakeFileHeader header;
+    std::memcpy(header.magic, "BWINTAKE", 8);
+    header.version = 1;
+    header.type    = type;
+    header.ntimes  = timeInRows ? input.nrow() : input.ncol();
+    header.nind    = timeInRows ? input.ncol() : input.nrow();
+    size_t size    = typeSize(header.type);
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == NULL){
+        stop("Unable to open " + path + " for writing.");
+    }
+    if (std::fwrite(&header, sizeof(IntakeFileHeader), 1, out) != 1){
+        std::fclose(out);
+        stop("Unable to write intake file " + path);
+    }
+
+    //Write each time with all individuals
+    std::vector<unsigned char> buffer(header.nind*size);
+    for (uint64_t i = 0; i < header.ntimes; i++){
+        for (uint64_t j = 0; j < header.nind; j++){
+            double val = timeInRows ? input(i, j) : input(j, i);
+            if (header.type == 1){
+                std::memcpy(&buffer[j*size], &val, size);
+            } else {
+                float fval = (float) val;
+                std::memcpy(&buffer[j*size], &fval, size);
+            }
+        }
+        if (std::fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()){
+            std::fclose(out);
+            stop("Unable to write intake file " + path);
+        }
+    }
+
+    if (std::fclose(out) != 0){
+        stop("Unable to write intake file " + path);
+    }
+}
+
+// [[Rcpp::export]]
+void intake_file_write_wrapper(NumericMatrix input, std::string path, bool timeInRows, int type){
+    writeIntakeFile(input, path, timeInRows, type);
+}
+
+// [[Rcpp::export]]
+List intake_file_info_wrapper(std::string path){
+    MappedFile file(path);
+    return List::create(Named("ntimes") = (double) file.header.ntimes,
+                        Named("nind")   = (double) file.header.nind,
+                        Named("type")   = (int) file.header.type);
+}
+
+//Smallest and largest value of file (NA if a value is not a number)
+// [[Rcpp::export]]
+NumericVector intake_file_range_wrapper(std::string path){
+    MappedFile file(path);
+    size_t nvalues = file.header.ntimes*file.header.nind;
+    double lower   = HUGE_VAL;
+    double upper   = -HUGE_VAL;
+    for (size_t k = 0; k < nvalues; k++){
+        double val;
+        if (file.header.type == 1){
+            std::memcpy(&val, file.values + k*sizeof(double), sizeof(double));
+        } else {
+            val = reinterpret_cast<const float*>(file.values)[k];
+        }
+        if (std::isnan(val)){
+            return NumericVector::create(NA_REAL, NA_REAL);
+        }
+        lower = std::min(lower, val);
+        upper = std::max(upper, val);
+    }
+    return NumericVector::create(lower, upper);
+}
@@ -0,0 +1,126 @@
+//
+//  input_matrix.h
+//
+//  This is a class that defines a time-major matrix of inputs (energy intake,
+//  sodium or physical activity) for the weight models. Each row is a time and
+//  each column an individual. Values are either held by R (NumericMatrix) or
+//  read from a memory mapped intake file so that the whole matrix never
+//  has to be loaded into memory.
+//
+//  Intake file format (little endian):
+//  magic           .-  8 bytes "BWINTAKE"
+//  version         .-  uint32 (currently 1)
+//  type            .-  uint32 1 = double (8 bytes); 2 = float (4 bytes)
+//  ntimes          .-  uint64 number of rows (times)
+//  nind            .-  uint64 number of columns (individuals)
+//  values          .-  ntimes*nind values; all individuals for time 0,
+//                      then all individuals for time 1, etc.
+//
+//  A matrix may be restricted to a subset of individuals (select) whose
+//  columns are read in place without copying the matrix or file.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef input_matrix_h
+#define input_matrix_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <Rcpp.h>
+#include "input_view.h"
+using namespace Rcpp;
+
+//Header of intake files
+//--------------------------------------------------------------------------------
+struct IntakeFileHeader {
+    char     magic[8];  //"BWINTAKE"
+    uint32_t version;   //Format version
+    uint32_t type;      //1 = double; 2 = float
+    uint64_t ntimes;    //Rows
+    uint64_t nind;      //Columns
+};
+
+//Read only memory map of an intake file
+//--------------------------------------------------------------------------------
+class MappedFile {
+public:
+    MappedFile(std::string path);
+    ~MappedFile(void);
+
+    IntakeFileHeader header;
+    const unsigned char* values; //First value after header
+
+private:
+    void*  address;
+    size_t length;
+#ifdef _WIN32
+    void*  file;
+    void*  mapping;
+#endif
+
+    void unmap(void);
+
+    //Not copyable: unmapped on destruction
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+//Time-major input matrix
+//--------------------------------------------------------------------------------
+class InputMatrix {
+public:
+
+    //Constructors: empty, held by R, or either of them from R (file path, matrix
+    //or list of either of them and the columns of a subset)
+    InputMatrix(void);
+    InputMatrix(NumericMatrix input);
+    InputMatrix(SEXP input);
+
+    //Matrix of individuals in columns (0, ..., ncol() - 1) of this matrix
+    InputMatrix select(const std::vector<int>& input_columns) const;
+
+    int nrow(void) const;
+    int ncol(void) const;
+
+    //Values for all individuals at time i
+    NumericVector row(int i);
+
+    //Value at time i of individual j
+    double operator()(int i, int j);
+
+    //View of values for the native engines (see input_view.h)
+    InputView view(void);
+
+private:
+    NumericMatrix values;
+    std::shared_ptr<MappedFile> file;
+    std::shared_ptr<std::vector<int> > columns; //Columns of subset (NULL for all)
+};
+
+//Write an R matrix into an intake file
+void writeIntakeFile(NumericMatrix input, std::string path, bool timeInRows, int type);
+
+#endif /* input_matrix_h */
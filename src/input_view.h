@@ -0,0 +1,81 @@
+//
+//  input_view.h
+//
+//  This is a read only view of a time-major input matrix (energy intake,
+//  sodium or physical activity) that does not depend on R. It points to the
+//  values of an InputMatrix (held by R or memory mapped) so that the native
+//  engines can read inputs from worker threads without calling the R API.
+//  Views are created on the main thread with InputMatrix::view() and are
+//  valid as long as the InputMatrix they come from. Views of a subset of
+//  individuals (InputMatrix::select) read the columns of the subset in place.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef input_view_h
+#define input_view_h
+
+#include <stddef.h>
+#include <string>
+#include <stdexcept>
+
+//View of input values: value (i,j) is at i*rowstride + j*colstride
+//--------------------------------------------------------------------------------
+struct InputView {
+
+    const double* values;  //Values if stored as double (otherwise NULL)
+    const float*  fvalues; //Values if stored as float (otherwise NULL)
+    size_t rowstride;
+    size_t colstride;
+    int    nrow;           //Times
+    int    ncol;           //Individuals
+    const int* columns;    //Column of each individual (NULL if individual j is column j)
+
+    InputView(void){
+        values    = NULL;
+        fvalues   = NULL;
+        rowstride = 0;
+        colstride = 0;
+        nrow      = 0;
+        ncol      = 0;
+        columns   = NULL;
+    }
+
+    //Checks (on the main thread, before the engine starts) that the view has
+    //the times 0, ..., nsteps read by nsteps steps as worker threads cannot stop
+    void check(int nsteps, const std::string& name) const {
+        if (nrow < nsteps + 1){
+            throw std::invalid_argument(name + " has fewer times than the steps of the model. "
+                                        "Please make sure it has days/dt + 1 times.");
+        }
+    }
+
+    //Value at time i (0, ..., nrow - 1; see check) of individual j
+    inline double operator()(int i, int j) const {
+        if (columns != NULL) j = columns[j];
+        size_t k = i*rowstride + j*colstride;
+        return values != NULL ? values[k] : (double) fvalues[k];
+    }
+};
+
+#endif /* input_view_h */
@@ -0,0 +1,109 @@
+//
+//  model_contrast.cpp
+//
+//  This is a function that computes the sums of the paired difference between
+//  a scenario and a baseline (see contrast_sink.h) from the outputs of two
+//  models returned to R (matrices held by R or by result files, read in place)
+//  and the design of the contrast used by the native engine (contrast.h).
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <Rcpp.h>
+#include "contrast.h"
+using namespace Rcpp;
+
+//Design as passed by contrast_cpp (model_contrast.R) for n individuals
+ContrastInput::ContrastInput(List input_design, int n){
+    
+    group   = as<IntegerVector>(input_design["group"]);
+    strata  = as<IntegerVector>(input_design["strata"]);
+    psu     = as<IntegerVector>(input_design["psu"]);
+    weights = as<NumericVector>(input_design["weights"]);
+    if (group.size() != n || strata.size() != n || psu.size() != n || weights.size() != n){
+        stop("Groups, weights, strata and PSUs of contrast must have one value per individual.");
+    }
+    
+    design.n         = n;
+    design.ngroups   = as<int>(input_design["ngroups"]);
+    design.nstrata   = as<int>(input_design["nstrata"]);
+    design.npsu      = as<int>(input_design["npsu"]);
+    design.group     = group.begin();
+    design.w         = weights.begin();
+    design.stratum   = strata.begin();
+    design.psu       = psu.begin();
+    design.threshold = NULL;
+    if (input_design.containsElementNamed("threshold")){
+        threshold = as<NumericVector>(input_design["threshold"]);
+        if (threshold.size() != n){
+            stop("Threshold of contrast must have one value per individual.");
+        }
+        design.threshold = threshold.begin();
+    }
+}
+
+//Sums as R arrays (by column)
+List contrastList(const ContrastSums& sums){
+    
+    NumericVector N(sums.N.begin(), sums.N.end());
+    NumericMatrix B(sums.nstrata, sums.ngroups);
+    NumericMatrix BB(sums.nstrata, sums.ngroups);
+    NumericVector A(sums.A.begin(), sums.A.end());
+    NumericVector AA(sums.AA.begin(), sums.AA.end());
+    NumericVector AB(sums.AB.begin(), sums.AB.end());
+    NumericVector Y(sums.Y.begin(), sums.Y.end());
+    std::copy(sums.B.begin(), sums.B.end(), B.begin());
+    std::copy(sums.BB.begin(), sums.BB.end(), BB.begin());
+    A.attr("dim")  = Dimension(sums.nstrata, sums.ngroups, sums.ndays);
+    AA.attr("dim") = Dimension(sums.nstrata, sums.ngroups, sums.ndays);
+    AB.attr("dim") = Dimension(sums.nstrata, sums.ngroups, sums.ndays);
+    Y.attr("dim")  = Dimension(sums.nstrata, sums.ngroups, sums.ndays);
+    
+    return List::create(Named("PSUs")                = N,
+                        Named("Sum_Weights")         = B,
+                        Named("Sum_Squared_Weights") = BB,
+                        Named("Differences")         = A,
+                        Named("Squared_Differences") = AA,
+                        Named("Cross_Products")      = AB,
+                        Named("Baseline_Sums")       = Y);
+}
+
+//Sums of contrast of the scenario and baseline (matrices of individuals x times)
+//at columns (from 0)
+// [[Rcpp::export]]
+List model_contrast_wrapper(NumericMatrix scenario, NumericMatrix baseline, IntegerVector columns,
+                            List design){
+    
+    if (scenario.nrow() != baseline.nrow() || scenario.ncol() != baseline.ncol()){
+        stop("Dimension mismatch. Scenario and baseline must have the same individuals and times.");
+    }
+    for (int d = 0; d < columns.size(); d++){
+        if (columns[d] < 0 || columns[d] >= scenario.ncol()){
+            stop("Contrast days must be times of both models.");
+        }
+    }
+    
+    //Matrices are read in place (result files are not loaded)
+    ContrastInput input(design, scenario.nrow());
+    return contrastList(contrastSums(input.design, baseline.begin(), scenario.begin(), scenario.nrow(),
+                                     std::vector<int>(columns.begin(), columns.end())));
+}
@@ -0,0 +1,485 @@
+//
+//  ode_engine.h
+//
+//  This is a function that defines the native (R independent) engine used to
+//  solve the weight models. The engine is a template on three policies chosen
+//  at compile time so that the inner loop has no virtual dispatch:
+//
+//  Model           .-  State layout and batch derivative kernel (see child_model.h
+//                      and adult_model.h). A model defines:
+//                        static const int nstates;
+//                        int  size() const;
+//                        void check(int nsteps) const;
+//                        void initial(double* y, int first, int n) const;
+//                        void derivatives(double t, const double* y, double* dy, int first, int n) const;
+//                        void implicitDerivatives(double t, const double* y, double* dy, int first, int n) const;
+//                        void implicitSolve(double t, double a, const double* r, double* y, int first, int n) const;
+//                        void jacobian(double t, const double* y, double* J, int first, int n) const;
+//                      where y holds the states of individuals first, ..., first + n - 1
+//                      by state (state k of individual first + j at y[k*n + j]).
+//                      check throws std::invalid_argument if the inputs of the
+//                      model do not cover nsteps steps.
+//  Integrator      .-  RK4, RK45, ABM, IMEX or ROS4 (see ode_integrators.h).
+//  Backend         .-  SerialBackend or ThreadBackend (std::thread).
+//
+//  Results are sent to a Sink (DenseSink, FinalSink or MeanSink) at each time
+//  step. Individuals are integrated in blocks; each block has its own copy of
+//  the sink (fork) which is merged (join) when the block is done.
+//
+//  The engine never calls R so blocks can be integrated in worker threads.
+//  Work vectors are WorkVectors (alloc_counter.h): the engine measures the
+//  allocations of the setup of each block and of each step (EngineStats).
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef ode_engine_h
+#define ode_engine_h
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include "alloc_counter.h"
+#include "ode_integrators.h"
+
+//Backends
+//--------------------------------------------------------------------------------
+
+//Run all blocks in the calling thread
+class SerialBackend {
+public:
+    template <class Task>
+    void run(int ntasks, Task& task){
+        for (int b = 0; b < ntasks; b++){
+            task(b);
+        }
+    }
+};
+
+//Run blocks in nthreads worker threads (0 = number of cores)
+class ThreadBackend {
+public:
+
+    ThreadBackend(int input_nthreads = 0){
+        nthreads = input_nthreads;
+        if (nthreads <= 0){
+            nthreads = std::max(1, (int) std::thread::hardware_concurrency());
+        }
+    }
+
+    template <class Task>
+    void run(int ntasks, Task& task){
+
+        std::atomic<int>   next(0);
+        std::exception_ptr error;
+        std::mutex         lock;
+
+        //Each worker takes the next block until none are left
+        std::vector<std::thread> workers;
+        int nworkers = std::min(nthreads, ntasks);
+        for (int w = 0; w < nworkers; w++){
+            workers.push_back(std::thread([&](){
+                try {
+                    int b;
+                    while ((b = next++) < ntasks){
+                        task(b);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!error) error = std::current_exception();
+                }
+            }));
+        }
+        for (int w = 0; w < nworkers; w++){
+            workers[w].join();
+        }
+
+        //Errors are raised in the calling thread
+        if (error) std::rethrow_exception(error);
+    }
+
+    int nthreads;
+};
+
+//Passes over blocks of individuals outside the engine (e.g. AdultModel::baseline):
+//f(first, n) is called for individuals first, ..., first + n - 1 of each block
+template <class Function>
+class BlockPass {
+public:
+
+    BlockPass(Function& input_f, int input_nind, int input_blocksize) : f(input_f) {
+        nind      = input_nind;
+        blocksize = input_blocksize;
+    }
+
+    void operator()(int b){
+        int first = b*blocksize;
+        f(first, std::min(blocksize, nind - first));
+    }
+
+private:
+    Function& f;
+    int nind;
+    int blocksize;
+};
+
+template <class Function>
+void forBlocks(int nind, int nthreads, Function f, int blocksize = 4096){
+    int nblocks = (nind + blocksize - 1)/blocksize;
+    BlockPass<Function> task(f, nind, blocksize);
+    if (nthreads == 1 || nblocks < 2){
+        SerialBackend().run(nblocks, task);
+    } else {
+        ThreadBackend(nthreads).run(nblocks, task);
+    }
+}
+
+//Sinks
+//--------------------------------------------------------------------------------
+
+//Full trajectories: state k of individual i at step s is written into
+//out[k][i + s*nind] (column major nind x (nsteps + 1) matrices as in R)
+class DenseSink {
+public:
+
+    DenseSink(std::vector<double*> input_out){
+        out  = input_out;
+        nind = 0;
+    }
+
+    void begin(int nsteps, int input_nind, int nstates){
+        nind = input_nind;
+    }
+
+    //Blocks write into disjoint rows of the same matrices
+    DenseSink fork(void){
+        return *this;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+        for (size_t k = 0; k < out.size(); k++){
+            double* col = out[k] + ((size_t) step)*nind + first;
+            for (int j = 0; j < n; j++){
+                col[j] = y[k*n + j];
+            }
+        }
+    }
+
+    void join(const DenseSink& local){}
+    void end(void){}
+
+private:
+    std::vector<double*> out;
+    int nind;
+};
+
+//States at last step only: state k of individual i in out[k][i]
+class FinalSink {
+public:
+
+    FinalSink(std::vector<double*> input_out){
+        out    = input_out;
+        nsteps = 0;
+    }
+
+    void begin(int input_nsteps, int nind, int nstates){
+        nsteps = input_nsteps;
+    }
+
+    FinalSink fork(void){
+        return *this;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+        if (step == nsteps){
+            for (size_t k = 0; k < out.size(); k++){
+                for (int j = 0; j < n; j++){
+                    out[k][first + j] = y[k*n + j];
+                }
+            }
+        }
+    }
+
+    void join(const FinalSink& local){}
+    void end(void){}
+
+private:
+    std::vector<double*> out;
+    int nsteps;
+};
+
+//Mean of each state across individuals at each step (mean(k, s) at k + s*nstates)
+class MeanSink {
+public:
+
+    MeanSink(void){
+        nind    = 0;
+        nstates = 0;
+    }
+
+    void begin(int nsteps, int input_nind, int input_nstates){
+        nind    = input_nind;
+        nstates = input_nstates;
+        sums.assign(((size_t) nsteps + 1)*nstates, 0.0);
+    }
+
+    //Each block accumulates its own sums
+    MeanSink fork(void){
+        MeanSink local = *this;
+        std::fill(local.sums.begin(), local.sums.end(), 0.0);
+        return local;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+        for (int k = 0; k < nstates; k++){
+            double total = 0.0;
+            for (int j = 0; j < n; j++){
+                total += y[k*n + j];
+            }
+            sums[((size_t) step)*nstates + k] += total;
+        }
+    }
+
+    void join(const MeanSink& local){
+        for (size_t s = 0; s < sums.size(); s++){
+            sums[s] += local.sums[s];
+        }
+    }
+
+    void end(void){}
+
+    double mean(int k, int step) const {
+        return sums[((size_t) step)*nstates + k]/nind;
+    }
+
+private:
+    WorkVector sums;
+    int nind;
+    int nstates;
+};
+
+//Whether some step of an integrator did not finish (only RK45 can fail)
+//--------------------------------------------------------------------------------
+template <class Integrator>
+inline bool failedStep(const Integrator& integrator){
+    return false;
+}
+
+template <class Model>
+inline bool failedStep(const RK45<Model>& integrator){
+    return integrator.failed;
+}
+
+//Summary of a run
+//--------------------------------------------------------------------------------
+//Allocations are those of CountingAllocator (alloc_counter.h) measured in each
+//block: setup is the workspace of the block (integrator and sink buffers) and each
+//step is the integration of the step and the write into the sink
+struct EngineStats {
+    bool   correct;     //All states finite
+    bool   failed;      //Some step did not reach its end (RK45 after maxsubsteps)
+    double evaluations; //Derivative evaluations (individuals x calls)
+    double setupCount;  //Allocations of the setup of blocks
+    double setupBytes;  //Bytes of the setup of blocks
+    std::vector<double> stepCount; //Allocations of step s (1, ..., nsteps) of all blocks at s - 1
+    std::vector<double> stepBytes; //Bytes of step s of all blocks at s - 1
+};
+
+//Engine
+//--------------------------------------------------------------------------------
+template <class Model, template <class> class Integrator, class Backend = SerialBackend>
+class OdeEngine {
+public:
+
+    OdeEngine(const Model& input_model, double input_dt, Backend input_backend = Backend(),
+              int input_blocksize = 256) : model(input_model) {
+        dt        = input_dt;
+        backend   = input_backend;
+        blocksize = std::max(1, input_blocksize);
+    }
+
+    //Integrator with settings (e.g. tolerances) copied to every block
+    Integrator<Model> integrator;
+
+    //Integrate nsteps steps of size dt writing states into sink
+    template <class Sink>
+    EngineStats run(int nsteps, Sink& sink){
+
+        int nind    = model.size();
+        int nblocks = (nind + blocksize - 1)/blocksize;
+
+        EngineStats stats;
+        stats.correct     = true;
+        stats.failed      = false;
+        stats.evaluations = 0.0;
+        stats.setupCount  = 0.0;
+        stats.setupBytes  = 0.0;
+        stats.stepCount.assign(nsteps, 0.0);
+        stats.stepBytes.assign(nsteps, 0.0);
+
+        model.check(nsteps);
+        sink.begin(nsteps, nind, Model::nstates);
+
+        std::mutex lock;
+        Block<Sink> task(*this, sink, stats, lock, nsteps);
+        backend.run(nblocks, task);
+
+        sink.end();
+
+        return stats;
+    }
+
+private:
+
+    const Model& model;
+    double  dt;
+    Backend backend;
+    int     blocksize;
+
+    //Integration of one block of individuals
+    template <class Sink>
+    class Block {
+    public:
+
+        Block(OdeEngine& input_engine, Sink& input_sink, EngineStats& input_stats,
+              std::mutex& input_lock, int input_nsteps) :
+              engine(input_engine), sink(input_sink), stats(input_stats), lock(input_lock){
+            nsteps = input_nsteps;
+        }
+
+        void operator()(int b){
+
+            const Model& model = engine.model;
+            int first   = b*engine.blocksize;
+            int n       = std::min(engine.blocksize, model.size() - first);
+            int nvalues = Model::nstates*n;
+
+            //Allocations of each step (std::vector as they are not part of the count)
+            std::vector<double> stepcount(nsteps, 0.0), stepbytes(nsteps, 0.0);
+            const AllocTally& tally = allocTally();
+            double count = tally.count;
+            double bytes = tally.bytes;
+
+            //Workspace (only allocations of the block)
+            WorkVector y(nvalues);
+            Integrator<Model> integrator = engine.integrator;
+            integrator.resize(nvalues);
+            Sink local = sink.fork();
+
+            //Initial states
+            model.initial(&y[0], first, n);
+            bool correct = finite(y);
+            local.write(0, 0.0, &y[0], first, n);
+            double setupcount = tally.count - count;
+            double setupbytes = tally.bytes - bytes;
+
+            //Time steps
+            for (int s = 1; s <= nsteps; s++){
+                count = tally.count;
+                bytes = tally.bytes;
+                integrator.advance(model, (s - 1)*engine.dt, engine.dt, &y[0], first, n);
+                correct = correct && finite(y);
+                local.write(s, s*engine.dt, &y[0], first, n);
+                stepcount[s - 1] = tally.count - count;
+                stepbytes[s - 1] = tally.bytes - bytes;
+            }
+
+            //Merge results
+            std::lock_guard<std::mutex> guard(lock);
+            sink.join(local);
+            stats.correct      = stats.correct && correct;
+            stats.failed       = stats.failed || failedStep(integrator);
+            stats.evaluations += ((double) integrator.evaluations)*n;
+            stats.setupCount  += setupcount;
+            stats.setupBytes  += setupbytes;
+            for (int s = 0; s < nsteps; s++){
+                stats.stepCount[s] += stepcount[s];
+                stats.stepBytes[s] += stepbytes[s];
+            }
+        }
+
+    private:
+
+        static bool finite(const WorkVector& y){
+            for (size_t k = 0; k < y.size(); k++){
+                if (!(std::fabs(y[k]) <= 1.0e300)) return false;
+            }
+            return true;
+        }
+
+        OdeEngine&   engine;
+        Sink&        sink;
+        EngineStats& stats;
+        std::mutex&  lock;
+        int          nsteps;
+    };
+};
+
+//Choose integrator and backend at run time (once) and integrate
+//--------------------------------------------------------------------------------
+template <class Model, class Backend, class Sink>
+EngineStats solveWith(const Model& model, double dt, int nsteps, std::string method,
+                      Backend backend, Sink& sink){
+    if (method == "rk4"){
+        OdeEngine<Model, RK4, Backend> engine(model, dt, backend);
+        return engine.run(nsteps, sink);
+    } else if (method == "rk45"){
+        OdeEngine<Model, RK45, Backend> engine(model, dt, backend);
+        return engine.run(nsteps, sink);
+    } else if (method == "abm"){
+        OdeEngine<Model, ABM, Backend> engine(model, dt, backend);
+        return engine.run(nsteps, sink);
+    } else if (method == "imex"){
+        OdeEngine<Model, IMEX, Backend> engine(model, dt, backend);
+        return engine.run(nsteps, sink);
+    } else if (method == "rosenbrock"){
+        OdeEngine<Model, ROS4, Backend> engine(model, dt, backend);
+        return engine.run(nsteps, sink);
+    }
+    throw std::invalid_argument("Invalid method " + method + ". Please choose rk4, rk45, abm, imex or rosenbrock.");
+}
+
+//Integrate and stop (R error or error of the C API) if a step did not finish
+template <class Model, class Sink>
+EngineStats solveModel(const Model& model, double dt, int nsteps, std::string method,
+                       int nthreads, Sink& sink){
+    EngineStats stats;
+    if (nthreads == 1){
+        stats = solveWith(model, dt, nsteps, method, SerialBackend(), sink);
+    } else {
+        stats = solveWith(model, dt, nsteps, method, ThreadBackend(nthreads), sink);
+    }
+    if (stats.failed){
+        throw std::runtime_error("Integrator " + method + " did not reach the end of a time step. "
+                                 "Please choose a smaller dt or another method.");
+    }
+    return stats;
+}
+
+#endif /* ode_engine_h */
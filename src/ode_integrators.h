@@ -0,0 +1,552 @@
+//
+//  ode_integrators.h
+//
+//  This is a function that defines the integrators of the native engine
+//  (see ode_engine.h). Integrators are policies: class templates on the
+//  model whose advance() moves the states of a block of individuals
+//  from t to t + h. Models are called directly (no virtual functions).
+//
+//  Integrators:
+//  RK4             .-  Classic Runge Kutta of order 4
+//  RK45            .-  Dormand-Prince 5(4) with adaptive substeps inside each time step
+//  ABM             .-  Adams-Bashforth-Moulton of order 4 (PECE) started with RK4
+//  IMEX            .-  Implicit-explicit Runge Kutta ARS(1,2,2) of order 2: the stiff
+//                      part of the model (implicitDerivatives) is solved implicitly
+//  ROS4            .-  Rosenbrock of order 4 with the Jacobian of the model (jacobian):
+//                      linearly implicit, one factorization per step
+//
+//  States of a block of n individuals are stored by state (state k of
+//  individual j at y[k*n + j]) and each integrator keeps its own workspace,
+//  so a block can be integrated by one thread without locks.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+// References:
+//
+//  Ascher, Uri M, Steven J Ruuth, and Raymond J Spiteri. 1997. “Implicit-Explicit Runge-Kutta Methods for
+//      Time-Dependent Partial Differential Equations.” Applied Numerical Mathematics 25 (2-3). Elsevier: 151–67.
+//
+//  Kaps, Peter, and Peter Rentrop. 1979. “Generalized Runge-Kutta Methods of Order Four with Stepsize
+//      Control for Stiff Ordinary Differential Equations.” Numerische Mathematik 33 (1): 55–68.
+//
+//  Dormand, John R, and Peter J Prince. 1980. “A Family of Embedded Runge-Kutta Formulae.”
+//      Journal of Computational and Applied Mathematics 6 (1). Elsevier: 19–26.
+//
+//  Hairer, Ernst, Syvert P Nørsett, and Gerhard Wanner. 1993. Solving Ordinary Differential Equations I:
+//      Nonstiff Problems. Springer Series in Computational Mathematics 8. Springer.
+//
+//  Shampine, Lawrence F. 1982. “Implementation of Rosenbrock Methods.” ACM Transactions on
+//      Mathematical Software 8 (2): 93–113.
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef ode_integrators_h
+#define ode_integrators_h
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "alloc_counter.h"
+
+//Runge Kutta 4
+//--------------------------------------------------------------------------------
+template <class Model>
+class RK4 {
+public:
+
+    RK4(void){
+        evaluations = 0;
+    }
+
+    //Allocate workspace for nvalues = nstates*n values
+    void resize(int nvalues){
+        k1.assign(nvalues, 0.0);
+        k2.assign(nvalues, 0.0);
+        k3.assign(nvalues, 0.0);
+        k4.assign(nvalues, 0.0);
+        tmp.assign(nvalues, 0.0);
+    }
+
+    void advance(const Model& model, double t, double h, double* y, int first, int n){
+
+        int nvalues = Model::nstates*n;
+
+        model.derivatives(t, y, &k1[0], first, n);
+        for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + 0.5*h*k1[k];
+
+        model.derivatives(t + 0.5*h, &tmp[0], &k2[0], first, n);
+        for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + 0.5*h*k2[k];
+
+        model.derivatives(t + 0.5*h, &tmp[0], &k3[0], first, n);
+        for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + h*k3[k];
+
+        model.derivatives(t + h, &tmp[0], &k4[0], first, n);
+        for (int k = 0; k < nvalues; k++){
+            y[k] += h*(k1[k] + 2.0*k2[k] + 2.0*k3[k] + k4[k])/6.0;
+        }
+
+        evaluations += 4;
+    }
+
+    long evaluations; //Calls to model derivatives
+
+private:
+    WorkVector k1, k2, k3, k4, tmp;
+};
+
+//Dormand-Prince 5(4) with step size control. Each call to advance lands
+//exactly on t + h (where inputs change) using as many substeps as needed
+//(at most maxsubsteps; otherwise failed is set and the engine stops).
+//--------------------------------------------------------------------------------
+template <class Model>
+class RK45 {
+public:
+
+    RK45(void){
+        evaluations = 0;
+        rtol        = 1.0e-6;
+        atol        = 1.0e-6;
+        hnext       = 0.0;
+        maxsubsteps = 100000;
+        failed      = false;
+    }
+
+    void resize(int nvalues){
+        for (int s = 0; s < 7; s++) k[s].assign(nvalues, 0.0);
+        tmp.assign(nvalues, 0.0);
+        ynew.assign(nvalues, 0.0);
+    }
+
+    void advance(const Model& model, double t, double h, double* y, int first, int n){
+
+        //Dormand-Prince tableau
+        static const double c2 = 1.0/5.0, c3 = 3.0/10.0, c4 = 4.0/5.0, c5 = 8.0/9.0;
+        static const double a21 = 1.0/5.0;
+        static const double a31 = 3.0/40.0, a32 = 9.0/40.0;
+        static const double a41 = 44.0/45.0, a42 = -56.0/15.0, a43 = 32.0/9.0;
+        static const double a51 = 19372.0/6561.0, a52 = -25360.0/2187.0, a53 = 64448.0/6561.0,
+                            a54 = -212.0/729.0;
+        static const double a61 = 9017.0/3168.0, a62 = -355.0/33.0, a63 = 46732.0/5247.0,
+                            a64 = 49.0/176.0, a65 = -5103.0/18656.0;
+        static const double b1 = 35.0/384.0, b3 = 500.0/1113.0, b4 = 125.0/192.0,
+                            b5 = -2187.0/6784.0, b6 = 11.0/84.0;
+        static const double e1 = 71.0/57600.0, e3 = -71.0/16695.0, e4 = 71.0/1920.0,
+                            e5 = -17253.0/339200.0, e6 = 22.0/525.0, e7 = -1.0/40.0;
+
+        int nvalues  = Model::nstates*n;
+        double tend  = t + h;
+        double hstep = (hnext > 0.0) ? std::min(hnext, h) : h;
+
+        model.derivatives(t, y, &k[0][0], first, n);
+        evaluations += 1;
+
+        for (int substep = 0; substep < maxsubsteps; substep++){
+
+            //Land exactly on end of time step
+            bool last = (t + hstep >= tend - 1.0e-12*h);
+            if (last) hstep = tend - t;
+
+            for (int j = 0; j < nvalues; j++) tmp[j] = y[j] + hstep*a21*k[0][j];
+            model.derivatives(t + c2*hstep, &tmp[0], &k[1][0], first, n);
+
+            for (int j = 0; j < nvalues; j++) tmp[j] = y[j] + hstep*(a31*k[0][j] + a32*k[1][j]);
+            model.derivatives(t + c3*hstep, &tmp[0], &k[2][0], first, n);
+
+            for (int j = 0; j < nvalues; j++) tmp[j] = y[j] + hstep*(a41*k[0][j] + a42*k[1][j] + a43*k[2][j]);
+            model.derivatives(t + c4*hstep, &tmp[0], &k[3][0], first, n);
+
+            for (int j = 0; j < nvalues; j++) tmp[j] = y[j] + hstep*(a51*k[0][j] + a52*k[1][j] + a53*k[2][j] +
+                                                                      a54*k[3][j]);
+            model.derivatives(t + c5*hstep, &tmp[0], &k[4][0], first, n);
+
+            for (int j = 0; j < nvalues; j++) tmp[j] = y[j] + hstep*(a61*k[0][j] + a62*k[1][j] + a63*k[2][j] +
+                                                                      a64*k[3][j] + a65*k[4][j]);
+            model.derivatives(t + hstep, &tmp[0], &k[5][0], first, n);
+
+            for (int j = 0; j < nvalues; j++) ynew[j] = y[j] + hstep*(b1*k[0][j] + b3*k[2][j] + b4*k[3][j] +
+                                                                       b5*k[4][j] + b6*k[5][j]);
+            model.derivatives(t + hstep, &ynew[0], &k[6][0], first, n);
+            evaluations += 6;
+
+            //Scaled error (largest of the block so that every individual meets the
+            //tolerances; a mean would let a few individuals hide among many)
+            double err = 0.0;
+            for (int j = 0; j < nvalues; j++){
+                double ej = hstep*(e1*k[0][j] + e3*k[2][j] + e4*k[3][j] + e5*k[4][j] + e6*k[5][j] + e7*k[6][j]);
+                double sc = atol + rtol*std::max(std::fabs(y[j]), std::fabs(ynew[j]));
+                double rj = std::fabs(ej)/sc;
+                if (rj > err || rj != rj) err = rj; //Keeps NaN
+            }
+
+            //New step size
+            double factor = (err > 0.0) ? 0.9*std::pow(err, -0.2) : 5.0;
+            factor = std::min(5.0, std::max(0.2, factor));
+
+            if (err <= 1.0 || !(err == err)){
+
+                //Accept (also keep NaN so that engine flags incorrect values)
+                std::copy(ynew.begin(), ynew.end(), y);
+                t += hstep;
+                if (last){
+                    hnext = hstep*factor;
+                    return;
+                }
+                k[0].swap(k[6]); //First same as last
+                hstep *= factor;
+
+            } else {
+                hstep *= factor;
+            }
+        }
+
+        failed = true;
+    }
+
+    double rtol;        //Relative tolerance
+    double atol;        //Absolute tolerance
+    int    maxsubsteps; //Maximum substeps in each time step
+    bool   failed;      //Whether maxsubsteps was reached
+    long   evaluations; //Calls to model derivatives
+
+private:
+    double hnext;
+    WorkVector k[7];
+    WorkVector tmp, ynew;
+};
+
+//Adams-Bashforth-Moulton of order 4 (predict, evaluate, correct, evaluate).
+//The first three steps are taken with RK4.
+//--------------------------------------------------------------------------------
+template <class Model>
+class ABM {
+public:
+
+    ABM(void){
+        evaluations = 0;
+        history     = 0;
+        cached      = false;
+    }
+
+    void resize(int nvalues){
+        for (int s = 0; s < 4; s++) f[s].assign(nvalues, 0.0);
+        fp.assign(nvalues, 0.0);
+        tmp.assign(nvalues, 0.0);
+        start.resize(nvalues);
+        history = 0;
+        cached  = false;
+    }
+
+    void advance(const Model& model, double t, double h, double* y, int first, int n){
+
+        int nvalues = Model::nstates*n;
+
+        //Derivative at t (cached from last correction)
+        if (!cached){
+            model.derivatives(t, y, &f[0][0], first, n);
+            evaluations += 1;
+        }
+
+        if (history < 3){
+
+            //Start with RK4 reusing f(t, y)
+            start.advanceFrom(model, t, h, y, &f[0][0], first, n);
+            evaluations += 3;
+            history     += 1;
+            cached       = false;
+
+        } else {
+
+            //Predict (Adams-Bashforth)
+            for (int j = 0; j < nvalues; j++){
+                tmp[j] = y[j] + h*(55.0*f[0][j] - 59.0*f[1][j] + 37.0*f[2][j] - 9.0*f[3][j])/24.0;
+            }
+            model.derivatives(t + h, &tmp[0], &fp[0], first, n);
+
+            //Correct (Adams-Moulton)
+            for (int j = 0; j < nvalues; j++){
+                y[j] += h*(9.0*fp[j] + 19.0*f[0][j] - 5.0*f[1][j] + f[2][j])/24.0;
+            }
+            evaluations += 1;
+        }
+
+        //Shift history: f[1] = f(t), f[2] = f(t - h), f[3] = f(t - 2h)
+        f[3].swap(f[2]);
+        f[2].swap(f[1]);
+        f[1].swap(f[0]);
+
+        //Evaluate at new point for next step
+        if (history >= 3){
+            model.derivatives(t + h, y, &f[0][0], first, n);
+            evaluations += 1;
+            cached = true;
+        }
+    }
+
+    long evaluations; //Calls to model derivatives
+
+private:
+
+    //RK4 with given first stage
+    class Start {
+    public:
+        void resize(int nvalues){
+            k2.assign(nvalues, 0.0);
+            k3.assign(nvalues, 0.0);
+            k4.assign(nvalues, 0.0);
+            tmp.assign(nvalues, 0.0);
+        }
+        void advanceFrom(const Model& model, double t, double h, double* y, const double* k1,
+                         int first, int n){
+            int nvalues = Model::nstates*n;
+            for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + 0.5*h*k1[k];
+            model.derivatives(t + 0.5*h, &tmp[0], &k2[0], first, n);
+            for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + 0.5*h*k2[k];
+            model.derivatives(t + 0.5*h, &tmp[0], &k3[0], first, n);
+            for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + h*k3[k];
+            model.derivatives(t + h, &tmp[0], &k4[0], first, n);
+            for (int k = 0; k < nvalues; k++){
+                y[k] += h*(k1[k] + 2.0*k2[k] + 2.0*k3[k] + k4[k])/6.0;
+            }
+        }
+    private:
+        WorkVector k2, k3, k4, tmp;
+    };
+
+    int  history; //Steps taken
+    bool cached;  //Whether f[0] = f(t, y)
+    WorkVector f[4];
+    WorkVector fp, tmp;
+    Start start;
+};
+
+//Implicit-explicit Runge Kutta ARS(1,2,2). The model splits its derivatives
+//as f = fE + fI where fI = implicitDerivatives is the stiff part and
+//implicitSolve(t, a, r, Y) solves Y - a*fI(t, Y) = r.
+//  Y    = y + h/2 fE(t, y) + h/2 fI(t + h/2, Y)
+//  ynew = y + h fE(t + h/2, Y) + h fI(t + h/2, Y)
+//--------------------------------------------------------------------------------
+template <class Model>
+class IMEX {
+public:
+
+    IMEX(void){
+        evaluations = 0;
+    }
+
+    void resize(int nvalues){
+        f.assign(nvalues, 0.0);
+        fi.assign(nvalues, 0.0);
+        rhs.assign(nvalues, 0.0);
+        Y.assign(nvalues, 0.0);
+    }
+
+    void advance(const Model& model, double t, double h, double* y, int first, int n){
+
+        int nvalues = Model::nstates*n;
+
+        //Explicit part at t
+        model.derivatives(t, y, &f[0], first, n);
+        model.implicitDerivatives(t, y, &fi[0], first, n);
+        for (int k = 0; k < nvalues; k++) rhs[k] = y[k] + 0.5*h*(f[k] - fi[k]);
+
+        //Implicit stage
+        model.implicitSolve(t + 0.5*h, 0.5*h, &rhs[0], &Y[0], first, n);
+
+        //Update with full derivative at stage
+        model.derivatives(t + 0.5*h, &Y[0], &f[0], first, n);
+        for (int k = 0; k < nvalues; k++) y[k] += h*f[k];
+
+        evaluations += 2;
+    }
+
+    long evaluations; //Calls to model derivatives
+
+private:
+    WorkVector f, fi, rhs, Y;
+};
+
+//Rosenbrock method of order 4 (Shampine 1982; Kaps and Rentrop 1979) with
+//four stages and three evaluations of the model:
+//
+//      (I - gamma*h*J) g_i = gamma*h*(f(t + a_i*h, y + sum_j a_ij g_j) + h*c_i*df/dt + sum_j c_ij g_j/h)
+//      y(t + h)            = y + sum_i b_i g_i
+//
+//  with gamma = 1/2. The model writes the Jacobian d f_k/d y_l of individual j at
+//  J[(k*nstates + l)*n + j] and df/dt is a forward difference inside the time
+//  step (inputs are constant in [t, t + h)). The nstates x nstates system of
+//  each individual is factored once per step. Being linearly implicit it takes
+//  steps far larger than the fast time scales of the model. Directions that grow
+//  faster than 1/(2*gamma*h) use a shifted matrix (see factor) which keeps the
+//  step stable at the cost of accuracy.
+//--------------------------------------------------------------------------------
+template <class Model>
+class ROS4 {
+public:
+
+    ROS4(void){
+        evaluations = 0;
+    }
+
+    void resize(int nvalues){
+        f.assign(nvalues, 0.0);
+        dfdt.assign(nvalues, 0.0);
+        g1.assign(nvalues, 0.0);
+        g2.assign(nvalues, 0.0);
+        g3.assign(nvalues, 0.0);
+        g4.assign(nvalues, 0.0);
+        tmp.assign(nvalues, 0.0);
+        J.assign(Model::nstates*nvalues, 0.0);
+        pivot.assign(nvalues, 0);
+    }
+
+    void advance(const Model& model, double t, double h, double* y, int first, int n){
+
+        //Shampine's parameters
+        const double gamma = 0.5;
+        const double a21 = 2.0, a31 = 48.0/25.0, a32 = 6.0/25.0;
+        const double c21 = -8.0, c31 = 372.0/25.0, c32 = 12.0/5.0;
+        const double c41 = -112.0/125.0, c42 = -54.0/125.0, c43 = -2.0/5.0;
+        const double b1 = 19.0/9.0, b2 = 0.5, b3 = 25.0/108.0, b4 = 125.0/108.0;
+        const double c1 = 0.5, c2 = -1.5, c3 = 121.0/50.0, c4 = 29.0/250.0;
+        const double a2 = 1.0, a3 = 3.0/5.0;
+
+        int nvalues = Model::nstates*n;
+
+        //Jacobian and time derivative at t
+        double dt = 1.0e-6*h;
+        model.derivatives(t, y, &f[0], first, n);
+        model.derivatives(t + dt, y, &dfdt[0], first, n);
+        for (int k = 0; k < nvalues; k++) dfdt[k] = (dfdt[k] - f[k])/dt;
+        model.jacobian(t, y, &J[0], first, n);
+        factor(gamma*h, n);
+
+        //Stages
+        for (int k = 0; k < nvalues; k++) tmp[k] = f[k] + h*c1*dfdt[k];
+        solve(&tmp[0], &g1[0], n);
+        for (int k = 0; k < nvalues; k++) g1[k] *= gamma*h;
+
+        for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + a21*g1[k];
+        model.derivatives(t + a2*h, &tmp[0], &f[0], first, n);
+        for (int k = 0; k < nvalues; k++) tmp[k] = f[k] + h*c2*dfdt[k] + c21*g1[k]/h;
+        solve(&tmp[0], &g2[0], n);
+        for (int k = 0; k < nvalues; k++) g2[k] *= gamma*h;
+
+        for (int k = 0; k < nvalues; k++) tmp[k] = y[k] + a31*g1[k] + a32*g2[k];
+        model.derivatives(t + a3*h, &tmp[0], &f[0], first, n);
+        for (int k = 0; k < nvalues; k++) tmp[k] = f[k] + h*c3*dfdt[k] + (c31*g1[k] + c32*g2[k])/h;
+        solve(&tmp[0], &g3[0], n);
+        for (int k = 0; k < nvalues; k++) g3[k] *= gamma*h;
+
+        for (int k = 0; k < nvalues; k++) tmp[k] = f[k] + h*c4*dfdt[k] + (c41*g1[k] + c42*g2[k] + c43*g3[k])/h;
+        solve(&tmp[0], &g4[0], n);
+        for (int k = 0; k < nvalues; k++) g4[k] *= gamma*h;
+
+        for (int k = 0; k < nvalues; k++){
+            y[k] += b1*g1[k] + b2*g2[k] + b3*g3[k] + b4*g4[k];
+        }
+
+        evaluations += 4;
+    }
+
+    long evaluations; //Calls to model derivatives
+
+private:
+
+    //Element (k,l) of the matrix of individual j
+    inline double& M(int k, int l, int j, int n){
+        return J[((size_t) k*Model::nstates + l)*n + j];
+    }
+
+    //LU with partial pivoting of I - a*J (in place). If an eigenvalue of J may exceed
+    //1/(2a) J is shifted so that I - a*J stays away from singular.
+    void factor(double a, int n){
+        const int m = Model::nstates;
+        for (int j = 0; j < n; j++){
+            double bound = largestEigenvalue(j, n);
+            if (a*bound > 0.5){
+                for (int k = 0; k < m; k++) M(k, k, j, n) -= bound - 0.5/a;
+            }
+            for (int k = 0; k < m; k++){
+                for (int l = 0; l < m; l++){
+                    M(k, l, j, n) = (k == l ? 1.0 : 0.0) - a*M(k, l, j, n);
+                }
+            }
+            for (int c = 0; c < m; c++){
+                int p = c;
+                for (int k = c + 1; k < m; k++){
+                    if (std::fabs(M(k, c, j, n)) > std::fabs(M(p, c, j, n))) p = k;
+                }
+                pivot[c*n + j] = p;
+                if (p != c){
+                    for (int l = 0; l < m; l++) std::swap(M(c, l, j, n), M(p, l, j, n));
+                }
+                for (int k = c + 1; k < m; k++){
+                    double mult  = M(k, c, j, n)/M(c, c, j, n);
+                    M(k, c, j, n) = mult;
+                    for (int l = c + 1; l < m; l++) M(k, l, j, n) -= mult*M(c, l, j, n);
+                }
+            }
+        }
+    }
+
+    //Largest real part of the eigenvalues of J (exact for two states, Gershgorin
+    //bound otherwise)
+    double largestEigenvalue(int j, int n){
+        const int m = Model::nstates;
+        if (m == 2){
+            double trace = M(0, 0, j, n) + M(1, 1, j, n);
+            double disc  = trace*trace - 4.0*(M(0, 0, j, n)*M(1, 1, j, n) - M(0, 1, j, n)*M(1, 0, j, n));
+            return 0.5*(trace + (disc > 0.0 ? std::sqrt(disc) : 0.0));
+        }
+        double bound = -1.0e300;
+        for (int k = 0; k < m; k++){
+            double row = M(k, k, j, n);
+            for (int l = 0; l < m; l++){
+                if (l != k) row += std::fabs(M(k, l, j, n));
+            }
+            bound = std::max(bound, row);
+        }
+        return bound;
+    }
+
+    //Solve factored system for right hand side b (by state) into x
+    void solve(const double* b, double* x, int n){
+        const int m = Model::nstates;
+        std::copy(b, b + m*n, x);
+        for (int j = 0; j < n; j++){
+            for (int c = 0; c < m; c++){
+                int p = pivot[c*n + j];
+                if (p != c) std::swap(x[c*n + j], x[p*n + j]);
+                for (int k = c + 1; k < m; k++) x[k*n + j] -= M(k, c, j, n)*x[c*n + j];
+            }
+            for (int c = m - 1; c >= 0; c--){
+                for (int l = c + 1; l < m; l++) x[c*n + j] -= M(c, l, j, n)*x[l*n + j];
+                x[c*n + j] /= M(c, c, j, n);
+            }
+        }
+    }
+
+    WorkVector f, dfdt, g1, g2, g3, g4, tmp, J;
+    WorkIndex  pivot;
+};
+
+#endif /* ode_integrators_h */
@@ -0,0 +1,292 @@
+//
+//  population_weight.cpp
+//
+//  This is a function that runs a population of children and adults: each
+//  partition runs in its engine (through the R independent entry points of
+//  engine_api.h) and both partitions run at the same time in two threads.
+//  Trajectories are returned with a row per individual of the population.
+//
+//  Variables:
+//  adult           .-  List with bw, ht, age, sex, EI, fat, pcarb_base, pcarb and
+//                      EIchange, NAchange and PAL (a row per time) of adults
+//  child           .-  List with age, sex, bmiCat, FFM, FM, referenceValues and
+//                      EI (a row per time) of children
+//  rows            .-  Rows (from 0) of each partition in the population
+//  nsteps          .-  Steps of the model
+//  regression      .-  Regression (regression.h) of each partition (or NULL)
+//  bootstrap       .-  Bootstrap (bootstrap.h) of each partition (or NULL)
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <thread>
+#include <algorithm>
+#include <Rcpp.h>
+#include "engine_api.h"
+using namespace Rcpp;
+
+#define POPULATION_ERROR 1000
+
+//Input of R matrix with a row per time
+static bw_input populationInput(NumericMatrix values){
+    bw_input input = {values.begin(), 1, values.nrow(), 1, values.nrow()};
+    return input;
+}
+
+//Values of vector (NULL if empty)
+static const double* populationValues(NumericVector values){
+    return values.size() > 0 ? values.begin() : NULL;
+}
+
+//Sums of bootstrap or regression of a partition computed by a thread
+struct PopulationSums {
+
+    //Bootstrap (as bootstrap.h)
+    void bootstrap(List design, int nind){
+        group   = as<IntegerVector>(design["group"]);
+        weights = as<NumericVector>(design["weights"]);
+        ids     = as<NumericVector>(design["ids"]);
+        steps   = as<IntegerVector>(design["steps"]);
+        int ngroups = as<int>(design["ngroups"]);
+        int B       = as<int>(design["replicates"]);
+        if (group.size() != nind || weights.size() != nind || ids.size() != nind){
+            stop("Groups, weights and ids of bootstrap must have one value per individual.");
+        }
+        W  = NumericVector(ngroups);
+        S  = NumericMatrix(ngroups, steps.size());
+        WB = NumericMatrix(B, ngroups);
+        SB = NumericVector(((size_t) B)*ngroups*steps.size());
+        SB.attr("dim") = Dimension(B, ngroups, steps.size());
+        boot.group      = group.begin();
+        boot.weights    = weights.begin();
+        boot.ids        = ids.begin();
+        boot.ngroups    = ngroups;
+        boot.replicates = B;
+        boot.seed       = as<double>(design["seed"]);
+        boot.steps      = steps.begin();
+        boot.ndays      = steps.size();
+        boot.W          = W.begin();
+        boot.S          = S.begin();
+        boot.WB         = WB.begin();
+        boot.SB         = SB.begin();
+    }
+
+    List bootstrapSums(void){
+        return List::create(Named("Sum_Weights")       = W,
+                            Named("Sums")              = S,
+                            Named("Replicate_Weights") = WB,
+                            Named("Replicate_Sums")    = SB);
+    }
+
+    //Regression (as regression.h)
+    void regression(List design, int nind){
+        X       = as<NumericMatrix>(design["X"]);
+        weights = as<NumericVector>(design["weights"]);
+        steps   = as<IntegerVector>(design["steps"]);
+        if (X.nrow() != nind || weights.size() != nind){
+            stop("Covariates and weights of regression must have one row per individual.");
+        }
+        int p      = X.ncol();
+        int npairs = p*(p + 1)/2;
+        N    = NumericVector(1);
+        SW   = NumericVector(1);
+        XtWX = NumericVector(npairs);
+        S4   = NumericMatrix(npairs, npairs);
+        XtWy = NumericMatrix(p, steps.size());
+        S2   = NumericMatrix(npairs, steps.size());
+        S3   = NumericMatrix(npairs*p, steps.size());
+        upper.resize(((size_t) npairs)*npairs);
+        reg.X       = X.begin();
+        reg.weights = weights.begin();
+        reg.p       = p;
+        reg.steps   = steps.begin();
+        reg.ndays   = steps.size();
+        reg.N       = N.begin();
+        reg.sw      = SW.begin();
+        reg.XtWX    = XtWX.begin();
+        reg.S4      = &upper[0];
+        reg.XtWy    = XtWy.begin();
+        reg.S2      = S2.begin();
+        reg.S3      = S3.begin();
+    }
+
+    List regressionSums(void){
+        int npairs = S4.nrow();
+        for (int k = 0; k < npairs; k++){
+            for (int l = k; l < npairs; l++){
+                S4(k, l) = upper[((size_t) k)*npairs + l];
+            }
+        }
+        return List::create(Named("N")           = N[0],
+                            Named("Sum_Weights") = SW[0],
+                            Named("XtWX")        = XtWX,
+                            Named("S4")          = S4,
+                            Named("XtWy")        = XtWy,
+                            Named("S2")          = S2,
+                            Named("S3")          = S3);
+    }
+
+    bw_bootstrap  boot;
+    bw_regression reg;
+    IntegerVector group;
+    IntegerVector steps;
+    NumericVector weights;
+    NumericVector ids;
+    NumericMatrix X;
+    NumericVector W, SB, N, SW, XtWX;
+    NumericMatrix S, WB, S4, XtWy, S2, S3;
+    std::vector<double> upper;
+};
+
+// [[Rcpp::export]]
+List population_weight_wrapper(List adult, List child, double dt, int nsteps, std::string method,
+                               int nthreads, bool qss, int growth, SEXP regression, SEXP bootstrap){
+
+    //Partitions (all R objects are read and allocated before threads start)
+    IntegerVector arows   = adult["rows"];
+    IntegerVector crows   = child["rows"];
+    int           nadult  = arows.size();
+    int           nchild  = crows.size();
+    int           nind    = nadult + nchild;
+    NumericVector abw     = adult["bw"],  aht  = adult["ht"],  aage = adult["age"], asex = adult["sex"];
+    NumericVector aEI     = adult["EI"],  afat = adult["fat"];
+    NumericVector apbase  = adult["pcarb_base"], apcarb = adult["pcarb"];
+    NumericMatrix aEIc    = adult["EIchange"], aNAc = adult["NAchange"], aPAL = adult["PAL"];
+    NumericVector cage    = child["age"], csex = child["sex"], cbmi = child["bmiCat"];
+    NumericVector cFFM    = child["FFM"], cFM  = child["FM"];
+    NumericMatrix cEI     = child["EI"];
+
+    bw_adult a = {nadult, abw.begin(), aht.begin(), aage.begin(), asex.begin(), apbase.begin(),
+                  apcarb.begin(), populationValues(aEI), populationValues(afat),
+                  populationInput(aEIc), populationInput(aNAc), populationInput(aPAL)};
+    bw_child c = {nchild, cage.begin(), csex.begin(), cbmi.begin(), cFFM.begin(), cFM.begin(),
+                  as<int>(child["referenceValues"]), populationInput(cEI)};
+
+    //Threads of each engine in proportion to its individuals
+    int total    = nthreads > 0 ? nthreads : std::max(1, (int) std::thread::hardware_concurrency());
+    int cthreads = std::min(total, std::max(1, (int) ((double) total*nchild/std::max(nind, 1) + 0.5)));
+    int athreads = std::max(1, total - cthreads);
+    if (nadult == 0) cthreads = total;
+    if (nchild == 0) athreads = total;
+    bw_options aoptions = {dt, nsteps, method.c_str(), athreads, qss, 0, 0};
+    bw_options coptions = {dt, nsteps, method.c_str(), cthreads, 0, growth, 0};
+
+    //Outputs of each partition
+    PopulationSums asums, csums;
+    std::vector<std::vector<double> > aout(7), chout(3);
+    bool   isbootstrap  = !Rf_isNull(bootstrap);
+    bool   trajectories = Rf_isNull(regression) && !isbootstrap;
+    size_t nvalues      = ((size_t) nsteps) + 1;
+    if (isbootstrap){
+        List designs = List(bootstrap);
+        if (nadult > 0) asums.bootstrap(designs["adult"], nadult);
+        if (nchild > 0) csums.bootstrap(designs["child"], nchild);
+    } else if (!Rf_isNull(regression)){
+        List designs = List(regression);
+        if (nadult > 0) asums.regression(designs["adult"], nadult);
+        if (nchild > 0) csums.regression(designs["child"], nchild);
+    } else {
+        for (int k = 1; k < 7 && nadult > 0; k++) aout[k].resize(nadult*nvalues);
+        for (int k = 0; k < 3 && nchild > 0; k++) chout[k].resize(nchild*nvalues);
+    }
+    std::vector<double*> apointers, cpointers;
+    for (size_t k = 0; k < aout.size(); k++){
+        apointers.push_back(aout[k].empty() ? NULL : &aout[k][0]);
+    }
+    for (size_t k = 0; k < chout.size(); k++){
+        cpointers.push_back(chout[k].empty() ? NULL : &chout[k][0]);
+    }
+
+    //Children run in a thread while adults run in this one
+    char aerror[POPULATION_ERROR] = "", cerror[POPULATION_ERROR] = "";
+    int  arc = 0, crc = 0;
+    std::thread children([&](){
+        if (nchild == 0) return;
+        if (trajectories){
+            crc = bw_child_trajectories(&c, &coptions, &cpointers[0], cerror, POPULATION_ERROR);
+        } else if (isbootstrap){
+            crc = bw_child_bootstrap(&c, &coptions, &csums.boot, cerror, POPULATION_ERROR);
+        } else {
+            crc = bw_child_regression(&c, &coptions, &csums.reg, cerror, POPULATION_ERROR);
+        }
+    });
+    if (nadult > 0){
+        if (trajectories){
+            arc = bw_adult_trajectories(&a, &aoptions, &apointers[0], aerror, POPULATION_ERROR);
+        } else if (isbootstrap){
+            arc = bw_adult_bootstrap(&a, &aoptions, &asums.boot, aerror, POPULATION_ERROR);
+        } else {
+            arc = bw_adult_regression(&a, &aoptions, &asums.reg, aerror, POPULATION_ERROR);
+        }
+    }
+    children.join();
+    if (arc != 0) stop(std::string("Adults: ") + aerror);
+    if (crc != 0) stop(std::string("Children: ") + cerror);
+    bool correct = (nadult == 0 || aoptions.correct) && (nchild == 0 || coptions.correct);
+
+    //Sums of each partition
+    if (isbootstrap){
+        return List::create(Named("Adult")          = nadult > 0 ? asums.bootstrapSums() : List(),
+                            Named("Child")          = nchild > 0 ? csums.bootstrapSums() : List(),
+                            Named("Correct_Values") = correct);
+    }
+    if (!trajectories){
+        return List::create(Named("Adult")          = nadult > 0 ? asums.regressionSums() : List(),
+                            Named("Child")          = nchild > 0 ? csums.regressionSums() : List(),
+                            Named("Correct_Values") = correct);
+    }
+
+    //Trajectories with a row per individual of the population
+    NumericVector TIME(nsteps + 1);
+    NumericMatrix AGE(nind, nsteps + 1), FM(nind, nsteps + 1), FFM(nind, nsteps + 1);
+    NumericMatrix BW(nind, nsteps + 1), TEI(nind, nsteps + 1);
+    for (int s = 0; s <= nsteps; s++){
+        TIME[s] = s*dt;
+        for (int j = 0; j < nadult; j++){
+            size_t k = ((size_t) s)*nadult + j;
+            int    i = arows[j];
+            AGE(i, s) = aage[j] + TIME[s]/365.0;
+            FM(i, s)  = aout[4][k];
+            BW(i, s)  = aout[5][k];
+            FFM(i, s) = aout[5][k] - aout[4][k];
+            TEI(i, s) = aout[6][k];
+        }
+        for (int j = 0; j < nchild; j++){
+            size_t k = ((size_t) s)*nchild + j;
+            int    i = crows[j];
+            AGE(i, s) = cage[j] + TIME[s]/365.0;
+            FFM(i, s) = chout[0][k];
+            FM(i, s)  = chout[1][k];
+            BW(i, s)  = chout[2][k];
+            TEI(i, s) = cEI(s, j);
+        }
+    }
+
+    return List::create(Named("Time")           = TIME,
+                        Named("Age")            = AGE,
+                        Named("Fat_Free_Mass")  = FFM,
+                        Named("Fat_Mass")       = FM,
+                        Named("Body_Weight")    = BW,
+                        Named("Energy_Intake")  = TEI,
+                        Named("Correct_Values") = correct);
+}
@@ -0,0 +1,92 @@
+//
+//  regression.h
+//
+//  This is a function that runs a model in the native engine with a
+//  RegressionSink (regression_sink.h) and returns its sums to R. Used by
+//  Child::regression and Adult::regression.
+//
+//  Variables:
+//  design          .-  List with covariates X (nind x p matrix), weights
+//                      and output steps
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef regression_h
+#define regression_h
+
+#include <Rcpp.h>
+#include "ode_engine.h"
+#include "regression_sink.h"
+using namespace Rcpp;
+
+template <class Model>
+List solveRegression(const Model& model, double dt, int nsims, std::string method,
+                     int nthreads, List design, bool& correct){
+    
+    NumericMatrix X       = design["X"];
+    NumericVector weights = design["weights"];
+    IntegerVector steps   = design["steps"];
+    
+    //Check design
+    if (X.nrow() != model.size() || weights.size() != model.size()){
+        stop("Covariates and weights of regression must have one row per individual.");
+    }
+    for (int d = 0; d < steps.size(); d++){
+        if (steps[d] < 0 || steps[d] > nsims){
+            stop("Regression days must be between 0 and the days of the model.");
+        }
+    }
+    
+    //Run without keeping trajectories
+    RegressionSink<Model> sink(model, X.begin(), weights.begin(), X.ncol(),
+                               std::vector<int>(steps.begin(), steps.end()));
+    EngineStats stats = solveModel(model, dt, nsims, method, nthreads, sink);
+    correct = stats.correct;
+    
+    //Sums as R matrices (by column)
+    const RegressionSums& sums = sink.sums;
+    NumericVector XtWX(sums.XtWX.begin(), sums.XtWX.end());
+    NumericMatrix S4(sums.npairs, sums.npairs);
+    for (int k = 0; k < sums.npairs; k++){
+        for (int l = k; l < sums.npairs; l++){
+            S4(k, l) = sums.S4[((size_t) k)*sums.npairs + l];
+        }
+    }
+    NumericMatrix XtWy(sums.p, sums.ndays);
+    NumericMatrix S2(sums.npairs, sums.ndays);
+    NumericMatrix S3(sums.npairs*sums.p, sums.ndays);
+    std::copy(sums.XtWy.begin(), sums.XtWy.end(), XtWy.begin());
+    std::copy(sums.S2.begin(), sums.S2.end(), S2.begin());
+    std::copy(sums.S3.begin(), sums.S3.end(), S3.begin());
+    
+    return List::create(Named("N")           = sums.n,
+                        Named("Sum_Weights") = sums.sw,
+                        Named("XtWX")        = XtWX,
+                        Named("S4")          = S4,
+                        Named("XtWy")        = XtWy,
+                        Named("S2")          = S2,
+                        Named("S3")          = S3);
+}
+
+#endif /* regression_h */
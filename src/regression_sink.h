@@ -0,0 +1,214 @@
+//
+//  regression_sink.h
+//
+//  This is a function that defines a sink of the native engine (see
+//  ode_engine.h) that regresses weight change since baseline on baseline
+//  covariates at chosen output days without keeping trajectories. It
+//  accumulates the weighted normal equations (X'WX and X'Wy) and the
+//  moments needed for the sandwich (robust) variance of the coefficients.
+//
+//  Variables:
+//  X               .-  Covariates (nind x p matrix by columns as in R)
+//  w               .-  Weights of individuals (e.g. survey weights)
+//  steps           .-  Output steps (days/dt) where weight change is regressed
+//
+//  For the sandwich variance sum_i w_i^2 e_i^2 x_i x_i' with e_i = y_i - x_i'b
+//  the residuals are not known until b is, so the sink keeps the sums of
+//  w^2 y^2 z, w^2 y z x' and w^2 z z' where z_i holds the products x_a x_b
+//  (a <= b) of individual i. Then
+//
+//      sum_i w_i^2 e_i^2 x_a x_b = S2[ab] - 2 sum_c S3[ab,c] b_c + sum_cd S4[ab,cd] b_c b_d
+//
+//  All accumulators are sums so blocks (threads) and runs over chunks of
+//  the population are merged by adding them.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef regression_sink_h
+#define regression_sink_h
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "alloc_counter.h"
+
+//Sums of the regression (pairs a <= b of covariates are ordered a = 0, b = 0, ..., p - 1;
+//a = 1, b = 1, ..., p - 1; ...)
+//--------------------------------------------------------------------------------
+struct RegressionSums {
+
+    int    p;      //Covariates
+    int    npairs; //p*(p + 1)/2
+    int    ndays;  //Output days
+    double n;      //Individuals
+    double sw;     //Sum of weights
+
+    std::vector<double> XtWX;  //sum w z                       (npairs)
+    std::vector<double> S4;    //sum w^2 z z' (upper triangle) (npairs x npairs)
+    std::vector<double> XtWy;  //sum w y x                     (p x ndays)
+    std::vector<double> S2;    //sum w^2 y^2 z                 (npairs x ndays)
+    std::vector<double> S3;    //sum w^2 y z x'                (npairs*p x ndays; pair k, covariate c at k*p + c)
+
+    RegressionSums(void){
+        p      = 0;
+        npairs = 0;
+        ndays  = 0;
+        n      = 0.0;
+        sw     = 0.0;
+    }
+
+    void resize(int input_p, int input_ndays){
+        p      = input_p;
+        npairs = p*(p + 1)/2;
+        ndays  = input_ndays;
+        n      = 0.0;
+        sw     = 0.0;
+        XtWX.assign(npairs, 0.0);
+        S4.assign(((size_t) npairs)*npairs, 0.0);
+        XtWy.assign(((size_t) p)*ndays, 0.0);
+        S2.assign(((size_t) npairs)*ndays, 0.0);
+        S3.assign(((size_t) npairs)*p*ndays, 0.0);
+    }
+
+    void add(const RegressionSums& other){
+        n  += other.n;
+        sw += other.sw;
+        for (size_t k = 0; k < XtWX.size(); k++) XtWX[k] += other.XtWX[k];
+        for (size_t k = 0; k < S4.size(); k++)   S4[k]   += other.S4[k];
+        for (size_t k = 0; k < XtWy.size(); k++) XtWy[k] += other.XtWy[k];
+        for (size_t k = 0; k < S2.size(); k++)   S2[k]   += other.S2[k];
+        for (size_t k = 0; k < S3.size(); k++)   S3[k]   += other.S3[k];
+    }
+};
+
+//Sink of the engine: the model gives body weight with
+//  double bodyWeight(int i, double t, const double* y, int j, int n) const;
+//--------------------------------------------------------------------------------
+template <class Model>
+class RegressionSink {
+public:
+
+    RegressionSink(const Model& input_model, const double* input_X, const double* input_w,
+                   int input_p, std::vector<int> input_steps) : model(input_model) {
+        X     = input_X;
+        w     = input_w;
+        p     = input_p;
+        steps = input_steps;
+        nind  = 0;
+    }
+
+    void begin(int nsteps, int input_nind, int nstates){
+        nind = input_nind;
+        index.assign(nsteps + 1, -1);
+        for (size_t d = 0; d < steps.size(); d++){
+            if (steps[d] < 0 || steps[d] > nsteps) continue;
+            if (index[steps[d]] >= 0){
+                throw std::invalid_argument("Output days of regression fall on the same step.");
+            }
+            index[steps[d]] = d;
+        }
+        sums.resize(p, steps.size());
+    }
+
+    //Each block accumulates its own sums
+    RegressionSink fork(void){
+        RegressionSink local = *this;
+        local.sums.resize(p, steps.size());
+        return local;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+
+        int npairs = sums.npairs;
+        x.resize(p);
+        z.resize(npairs);
+
+        //Baseline weight and moments of covariates
+        if (step == 0){
+            baseline.resize(n);
+            for (int j = 0; j < n; j++){
+                int    i  = first + j;
+                double wi = w[i];
+                baseline[j] = model.bodyWeight(i, t, y, j, n);
+                products(i);
+                sums.n  += 1.0;
+                sums.sw += wi;
+                for (int k = 0; k < npairs; k++){
+                    sums.XtWX[k] += wi*z[k];
+                    double* row = &sums.S4[((size_t) k)*npairs];
+                    for (int l = k; l < npairs; l++) row[l] += wi*wi*z[k]*z[l];
+                }
+            }
+        }
+
+        //Regression at output days
+        int d = index[step];
+        if (d < 0) return;
+        double* XtWy = &sums.XtWy[((size_t) d)*p];
+        double* S2   = &sums.S2[((size_t) d)*npairs];
+        double* S3   = &sums.S3[((size_t) d)*npairs*p];
+        for (int j = 0; j < n; j++){
+            int    i  = first + j;
+            double wi = w[i];
+            double yi = model.bodyWeight(i, t, y, j, n) - baseline[j];
+            products(i);
+            for (int a = 0; a < p; a++) XtWy[a] += wi*yi*x[a];
+            for (int k = 0; k < npairs; k++){
+                S2[k] += wi*wi*yi*yi*z[k];
+                for (int c = 0; c < p; c++) S3[k*p + c] += wi*wi*yi*z[k]*x[c];
+            }
+        }
+    }
+
+    void join(const RegressionSink& local){
+        sums.add(local.sums);
+    }
+
+    void end(void){}
+
+    RegressionSums sums;
+
+private:
+
+    //Covariates x and products z of individual i
+    void products(int i){
+        for (int a = 0; a < p; a++) x[a] = X[((size_t) a)*nind + i];
+        int k = 0;
+        for (int a = 0; a < p; a++){
+            for (int b = a; b < p; b++) z[k++] = x[a]*x[b];
+        }
+    }
+
+    const Model&        model;
+    const double*       X;
+    const double*       w;
+    int                 p;
+    int                 nind;
+    std::vector<int>    steps;
+    std::vector<int>    index;    //Output day of each step (-1 if none)
+    WorkVector          baseline; //Weight at baseline of individuals in block
+    WorkVector          x, z;
+};
+
+#endif /* regression_sink_h */
@@ -0,0 +1,205 @@
+//
+//  result_file.cpp
+//
+//  This is a function that implements the result files of the native engine
+//  and the ALTREP class (R >= 3.6.0) through which R reads them. See
+//  result_file.h.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <algorithm>
+#include <Rversion.h>
+#include "result_file.h"
+#include "input_matrix.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef R_VERSION
+#if R_VERSION >= R_Version(3, 6, 0)
+#define BW_ALTREP
+#include <R_ext/Altrep.h>
+#endif
+#endif
+
+ResultFile::ResultFile(std::string input_path, int nrow, int ncol){
+
+    path    = input_path;
+    address = NULL;
+    length  = ((R_xlen_t) nrow)*ncol;
+    bytes   = sizeof(IntakeFileHeader) + length*sizeof(double);
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        stop("Unable to create result file " + path);
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD) (((uint64_t) bytes) >> 32),
+                                 (DWORD) (bytes & 0xFFFFFFFF), NULL);
+    if (mapping != NULL){
+        address = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    }
+    if (address == NULL){
+        if (mapping != NULL) CloseHandle(mapping);
+        CloseHandle(file);
+        stop("Unable to memory map result file " + path);
+    }
+#else
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0){
+        stop("Unable to create result file " + path);
+    }
+    if (ftruncate(fd, bytes) != 0){
+        close(fd);
+        stop("Unable to allocate result file " + path + ". Please check the space in disk.");
+    }
+    address = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); //Mapping remains valid after closing the descriptor
+    if (address == MAP_FAILED){
+        address = NULL;
+        stop("Unable to memory map result file " + path);
+    }
+#endif
+
+    //Header of intake file with times as rows
+    IntakeFileHeader header;
+    std::memcpy(header.magic, "BWINTAKE", 8);
+    header.version = 1;
+    header.type    = 1;
+    header.ntimes  = ncol;
+    header.nind    = nrow;
+    std::memcpy(address, &header, sizeof(IntakeFileHeader));
+
+    values = reinterpret_cast<double*>(static_cast<unsigned char*>(address) + sizeof(IntakeFileHeader));
+}
+
+ResultFile::~ResultFile(void){
+    if (address != NULL){
+#ifdef _WIN32
+        UnmapViewOfFile(address);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(address, bytes);
+#endif
+        address = NULL;
+    }
+}
+
+#ifdef BW_ALTREP
+
+//ALTREP class of matrices in result files: data1 is an external pointer to the
+//ResultFile which is deleted (unmapped) when R collects the matrix
+//--------------------------------------------------------------------------------
+static R_altrep_class_t result_class;
+
+static ResultFile* resultFile(SEXP x){
+    return static_cast<ResultFile*>(R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+
+static void resultFinalizer(SEXP ptr){
+    delete static_cast<ResultFile*>(R_ExternalPtrAddr(ptr));
+    R_ClearExternalPtr(ptr);
+}
+
+static R_xlen_t resultLength(SEXP x){
+    return resultFile(x)->length;
+}
+
+static void* resultDataptr(SEXP x, Rboolean writeable){
+    return resultFile(x)->values;
+}
+
+static const void* resultDataptrOrNull(SEXP x){
+    return resultFile(x)->values;
+}
+
+static double resultElt(SEXP x, R_xlen_t i){
+    return resultFile(x)->values[i];
+}
+
+static R_xlen_t resultGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, double* buf){
+    ResultFile* file = resultFile(x);
+    R_xlen_t ncopy = std::max((R_xlen_t) 0, std::min(n, file->length - i));
+    std::memcpy(buf, file->values + i, ncopy*sizeof(double));
+    return ncopy;
+}
+
+static Rboolean resultInspect(SEXP x, int pre, int deep, int pvec,
+                              void (*inspect_subtree)(SEXP, int, int, int)){
+    Rprintf(" bw result file %s\n", resultFile(x)->path.c_str());
+    return TRUE;
+}
+
+#endif
+
+//Registration of ALTREP class when package is loaded
+// [[Rcpp::init]]
+void result_file_init(DllInfo* dll){
+#ifdef BW_ALTREP
+    result_class = R_make_altreal_class("bw_result_file", "bw", dll);
+    R_set_altrep_Length_method(result_class, resultLength);
+    R_set_altrep_Inspect_method(result_class, resultInspect);
+    R_set_altvec_Dataptr_method(result_class, resultDataptr);
+    R_set_altvec_Dataptr_or_null_method(result_class, resultDataptrOrNull);
+    R_set_altreal_Elt_method(result_class, resultElt);
+    R_set_altreal_Get_region_method(result_class, resultGetRegion);
+#endif
+}
+
+std::string resultPath(std::string output, std::string name){
+    if (output.empty()){
+        return "";
+    }
+    return output + name + ".bw";
+}
+
+NumericMatrix resultMatrix(int nrow, int ncol, std::string path){
+
+    if (path.empty()){
+        return NumericMatrix(nrow, ncol);
+    }
+
+#ifdef BW_ALTREP
+    ResultFile* file = new ResultFile(path, nrow, ncol);
+    SEXP ptr = PROTECT(R_MakeExternalPtr(file, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(ptr, resultFinalizer, TRUE);
+    SEXP x   = PROTECT(R_new_altrep(result_class, ptr, R_NilValue));
+    Rf_setAttrib(x, R_DimSymbol, Dimension(nrow, ncol));
+    NumericMatrix result(x);
+    UNPROTECT(2);
+    return result;
+#else
+    stop("Result files need R >= 3.6.0.");
+    return NumericMatrix(nrow, ncol);
+#endif
+}
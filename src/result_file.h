@@ -0,0 +1,79 @@
+//
+//  result_file.h
+//
+//  This is a function that defines the matrices of results of the native
+//  engine (Adult::solve and Child::solve). Results are either held by R or
+//  written by the engine into a memory mapped result file which R reads as
+//  an ALTREP matrix backed by the map: large results are never copied nor
+//  loaded into memory.
+//
+//  Result files have the format of intake files (see input_matrix.h) with
+//  the columns of the matrix (times) as rows of the file and the rows of the
+//  matrix (individuals) as columns so that they can also be opened with
+//  intake_file. The map is removed when R no longer uses the matrix; the
+//  file is kept.
+//
+//  Variables:
+//  nrow            .-  Rows of matrix (individuals)
+//  ncol            .-  Columns of matrix (times)
+//  path            .-  Path of result file ("" for a matrix held by R)
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef result_file_h
+#define result_file_h
+
+#include <string>
+#include <Rcpp.h>
+using namespace Rcpp;
+
+class ResultFile {
+public:
+    ResultFile(std::string input_path, int nrow, int ncol);
+    ~ResultFile(void);
+
+    std::string path;
+    double*     values; //First value after header
+    R_xlen_t    length; //Number of values
+
+private:
+    void*  address;
+    size_t bytes;
+#ifdef _WIN32
+    void*  file;
+    void*  mapping;
+#endif
+
+    //Not copyable: unmapped on destruction
+    ResultFile(const ResultFile&);
+    ResultFile& operator=(const ResultFile&);
+};
+
+//Matrix of results held by R (path = "") or by a result file
+NumericMatrix resultMatrix(int nrow, int ncol, std::string path);
+
+//Path of result file of variable name in directory output ("" if output is "")
+std::string resultPath(std::string output, std::string name);
+
+#endif /* result_file_h */
@@ -0,0 +1,68 @@
+//
+//  result_writer.cpp
+//
+//  This is a function that writes the trajectories of a model returned to R
+//  (matrices held by R or by result files) as text with the writer of
+//  result_writer.h. Trajectories are read in place.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#include <Rcpp.h>
+#include "result_writer.h"
+using namespace Rcpp;
+
+//Writes variables (matrices of individuals x times) at columns (from 0) into file
+// [[Rcpp::export]]
+void model_write_wrapper(List variables, NumericVector ids, NumericVector times, IntegerVector columns,
+                         std::string file, bool wide, std::string sep, int digits, bool gzip,
+                         int level, int nthreads){
+
+    //Matrices are read in place (result files are not loaded)
+    ResultTable table;
+    CharacterVector names = variables.names();
+    table.nrow = ids.size();
+    table.ncol = times.size();
+    for (int v = 0; v < variables.size(); v++){
+        NumericMatrix values = variables[v];
+        if (values.nrow() != table.nrow || values.ncol() != table.ncol){
+            stop("Dimension mismatch. Variables must have a row per individual and a column per time.");
+        }
+        table.values.push_back(values.begin());
+        table.names.push_back(as<std::string>(names[v]));
+    }
+    table.ids     = std::vector<double>(ids.begin(), ids.end());
+    table.times   = std::vector<double>(times.begin(), times.end());
+    table.columns = std::vector<int>(columns.begin(), columns.end());
+
+    WriterOptions options;
+    options.wide     = wide;
+    options.sep      = sep[0];
+    options.digits   = digits;
+    options.gzip     = gzip;
+    options.level    = level;
+    options.nthreads = nthreads;
+
+    ResultWriter writer(table, options);
+    writer.write(file);
+}
@@ -0,0 +1,329 @@
+//
+//  result_writer.h
+//
+//  This is a function that writes the trajectories of a model as text
+//  (comma or tab separated, optionally gzip compressed) without building
+//  data frames. It does not depend on R.
+//
+//  Variables:
+//  values          .-  Trajectories of each variable (nrow x ncol matrices by
+//                      column as in R)
+//  names           .-  Names of variables
+//  ids             .-  Identifier of each row (individual)
+//  times           .-  Day of each column
+//  columns         .-  Columns (days) that are written
+//
+//  Layouts are long (id, day, variable, value) or wide (id, day and a column
+//  per variable). Rows are formatted in chunks of individuals by worker
+//  threads (ThreadBackend of ode_engine.h) and written in order. Numbers are
+//  formatted with integer arithmetic (rounded to the chosen decimals) instead
+//  of printf. Compressed files have a gzip member per chunk so chunks are
+//  compressed in parallel (concatenated members are a gzip file).
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef result_writer_h
+#define result_writer_h
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+#include <zlib.h>
+#include "ode_engine.h"
+
+//Values per chunk of individuals formatted by a thread
+#define WRITER_CHUNK_VALUES 65536
+
+//Characters of a formatted number
+#define WRITER_NUMBER_CHARS 32
+
+//Trajectories to write
+struct ResultTable {
+    std::vector<const double*> values;
+    std::vector<std::string>   names;
+    std::vector<double>        ids;
+    std::vector<double>        times;
+    std::vector<int>           columns;
+    int                        nrow;
+    int                        ncol;
+};
+
+struct WriterOptions {
+    bool wide;     //Column per variable
+    char sep;      //',' or '\t'
+    int  digits;   //Decimals (0, ..., 15)
+    bool gzip;     //Compress
+    int  level;    //Level of compression (1, ..., 9)
+    int  nthreads; //Threads (0 = number of cores)
+};
+
+//Writes x rounded to digits decimals (trailing zeros removed) at p and returns
+//the end; NaN as NA (as read by R) and large numbers with 15 significant digits
+inline char* formatNumber(double x, int digits, char* p){
+
+    static const double scale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+                                   1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    if (std::isnan(x)){
+        *p++ = 'N';
+        *p++ = 'A';
+        return p;
+    }
+    if (std::isinf(x)){
+        if (x < 0) *p++ = '-';
+        std::memcpy(p, "Inf", 3);
+        return p + 3;
+    }
+    double scaled = std::fabs(x)*scale[digits];
+    if (scaled >= 9e15){
+        return p + std::snprintf(p, WRITER_NUMBER_CHARS, "%.15g", x);
+    }
+
+    //Integer and decimal parts of the rounded number
+    uint64_t rounded  = (uint64_t) (scaled + 0.5);
+    uint64_t unit     = (uint64_t) scale[digits];
+    uint64_t integer  = rounded/unit;
+    uint64_t decimals = rounded % unit;
+    if (x < 0 && rounded > 0) *p++ = '-';
+
+    char reversed[24];
+    int  k = 0;
+    do {
+        reversed[k++] = (char) ('0' + integer % 10);
+        integer      /= 10;
+    } while (integer > 0);
+    while (k > 0) *p++ = reversed[--k];
+
+    if (decimals > 0){
+        int ndecimals = digits;
+        while (decimals % 10 == 0){
+            decimals /= 10;
+            ndecimals--;
+        }
+        *p++ = '.';
+        for (int d = ndecimals - 1; d >= 0; d--){
+            p[d]      = (char) ('0' + decimals % 10);
+            decimals /= 10;
+        }
+        p += ndecimals;
+    }
+
+    return p;
+}
+
+//Gzip member with the characters of text
+inline std::vector<char> gzipMember(const std::vector<char>& text, int level){
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+        throw std::runtime_error("Unable to start gzip compression.");
+    }
+    std::vector<char> member(deflateBound(&stream, text.size()) + 32);
+    stream.next_in   = (Bytef*) (text.empty() ? NULL : &text[0]);
+    stream.avail_in  = (uInt) text.size();
+    stream.next_out  = (Bytef*) &member[0];
+    stream.avail_out = (uInt) member.size();
+    int status = deflate(&stream, Z_FINISH);
+    member.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END){
+        throw std::runtime_error("Unable to compress results.");
+    }
+
+    return member;
+}
+
+class ResultWriter {
+public:
+
+    ResultWriter(const ResultTable& input_table, const WriterOptions& input_options) :
+        table(input_table), options(input_options){
+
+        if (options.digits < 0 || options.digits > 15){
+            throw std::invalid_argument("Invalid digits. Please choose between 0 and 15 decimals.");
+        }
+        if ((int) table.ids.size() != table.nrow || (int) table.times.size() != table.ncol ||
+            table.values.size() != table.names.size() || table.values.empty()){
+            throw std::invalid_argument("Invalid results to write.");
+        }
+        for (size_t d = 0; d < table.columns.size(); d++){
+            if (table.columns[d] < 0 || table.columns[d] >= table.ncol){
+                throw std::invalid_argument("Invalid days to write.");
+            }
+        }
+
+        //Days and longest line
+        size_t longest = 0;
+        for (size_t v = 0; v < table.names.size(); v++){
+            longest = std::max(longest, table.names[v].size());
+        }
+        for (size_t d = 0; d < table.columns.size(); d++){
+            char  day[WRITER_NUMBER_CHARS];
+            char* end = formatNumber(table.times[table.columns[d]], options.digits, day);
+            days.push_back(std::string(day, end));
+        }
+        if (options.wide){
+            linechars = (table.values.size() + 2)*(WRITER_NUMBER_CHARS + 1);
+        } else {
+            linechars = 3*(WRITER_NUMBER_CHARS + 1) + longest + 1;
+        }
+
+        //Chunks of individuals
+        size_t perindividual = std::max((size_t) 1, table.columns.size()*table.values.size());
+        chunkrows = (int) std::max((size_t) 1, WRITER_CHUNK_VALUES/perindividual);
+        nchunks   = (table.nrow + chunkrows - 1)/chunkrows;
+    }
+
+    void write(const std::string& path){
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == NULL){
+            throw std::runtime_error("Unable to open " + path + " for writing.");
+        }
+
+        try {
+
+            //Header
+            std::string header = "id" + std::string(1, options.sep) + "day";
+            if (options.wide){
+                for (size_t v = 0; v < table.names.size(); v++){
+                    header += options.sep + table.names[v];
+                }
+            } else {
+                header += options.sep + std::string("variable") + options.sep + "value";
+            }
+            header += '\n';
+            output(file, std::vector<char>(header.begin(), header.end()));
+
+            //Chunks are formatted (and compressed) by threads in waves and written in order
+            ThreadBackend backend(options.nthreads);
+            int wave = 4*backend.nthreads;
+            std::vector<std::vector<char> > chunks(wave);
+            for (int first = 0; first < nchunks; first += wave){
+                int nwave = std::min(wave, nchunks - first);
+                ChunkTask task(this, first, chunks);
+                backend.run(nwave, task);
+                for (int c = 0; c < nwave; c++){
+                    if (!chunks[c].empty() && std::fwrite(&chunks[c][0], 1, chunks[c].size(), file) != chunks[c].size()){
+                        throw std::runtime_error("Unable to write " + path + ".");
+                    }
+                    std::vector<char>().swap(chunks[c]);
+                }
+            }
+
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+
+        if (std::fclose(file) != 0){
+            throw std::runtime_error("Unable to write " + path + ".");
+        }
+    }
+
+private:
+
+    //Text of individuals of chunk c
+    std::vector<char> format(int c) const {
+
+        int first = c*chunkrows;
+        int last  = std::min(table.nrow, first + chunkrows);
+        std::vector<char> text((size_t) (last - first)*table.columns.size()*
+                               (options.wide ? 1 : table.values.size())*linechars);
+        char* p = text.empty() ? NULL : &text[0];
+
+        for (int i = first; i < last; i++){
+            char  id[WRITER_NUMBER_CHARS];
+            char* idend = formatNumber(table.ids[i], options.digits, id);
+            for (size_t d = 0; d < table.columns.size(); d++){
+                size_t index = (size_t) i + (size_t) table.columns[d]*table.nrow;
+                if (options.wide){
+                    p = prefix(p, id, idend, d);
+                    for (size_t v = 0; v < table.values.size(); v++){
+                        *p++ = options.sep;
+                        p    = formatNumber(table.values[v][index], options.digits, p);
+                    }
+                    *p++ = '\n';
+                } else {
+                    for (size_t v = 0; v < table.values.size(); v++){
+                        p    = prefix(p, id, idend, d);
+                        *p++ = options.sep;
+                        std::memcpy(p, table.names[v].data(), table.names[v].size());
+                        p   += table.names[v].size();
+                        *p++ = options.sep;
+                        p    = formatNumber(table.values[v][index], options.digits, p);
+                        *p++ = '\n';
+                    }
+                }
+            }
+        }
+        text.resize(text.empty() ? 0 : p - &text[0]);
+
+        return text;
+    }
+
+    //Id and day of line
+    char* prefix(char* p, const char* id, const char* idend, size_t d) const {
+        std::memcpy(p, id, idend - id);
+        p   += idend - id;
+        *p++ = options.sep;
+        std::memcpy(p, days[d].data(), days[d].size());
+        return p + days[d].size();
+    }
+
+    void output(std::FILE* file, const std::vector<char>& text) const {
+        std::vector<char> bytes = options.gzip ? gzipMember(text, options.level) : text;
+        if (!bytes.empty() && std::fwrite(&bytes[0], 1, bytes.size(), file) != bytes.size()){
+            throw std::runtime_error("Unable to write results.");
+        }
+    }
+
+    //Formats chunks first, ..., first + ntasks - 1 into chunks
+    struct ChunkTask {
+        ChunkTask(const ResultWriter* input_writer, int input_first, std::vector<std::vector<char> >& input_chunks) :
+            writer(input_writer), first(input_first), chunks(input_chunks){}
+        void operator()(int b){
+            chunks[b] = writer->format(first + b);
+            if (writer->options.gzip){
+                chunks[b] = gzipMember(chunks[b], writer->options.level);
+            }
+        }
+        const ResultWriter*              writer;
+        int                              first;
+        std::vector<std::vector<char> >& chunks;
+    };
+
+    const ResultTable&       table;
+    WriterOptions            options;
+    std::vector<std::string> days;
+    size_t                   linechars;
+    int                      chunkrows;
+    int                      nchunks;
+};
+
+#endif /* result_writer_h */
@@ -0,0 +1,138 @@
+//
+//  window_sink.h
+//
+//  This is a function that defines a sink of the native engine (see
+//  ode_engine.h) that keeps only chosen output days of the outputs of a
+//  model, each one either the value at the day or its mean over a window of
+//  days that ends at it, without keeping trajectories.
+//
+//  Variables:
+//  out             .-  Outputs (nind x ndays matrices by column as in R)
+//  steps           .-  Output steps (days/dt)
+//  width           .-  Steps of the window (0 for the value at the step)
+//
+//  The mean of output v over the window [a, b] (a = max(0, b - width)) is
+//  the trapezoidal rule over the steps of the window divided by its length:
+//
+//      (v[a]/2 + v[a + 1] + ... + v[b - 1] + v[b]/2)/(b - a)
+//
+//  which is exact for outputs linear between steps. Windows may overlap (each
+//  step keeps the output days whose window it is in). Blocks write into
+//  disjoint rows of the matrices.
+//
+//  Authors:
+//  Dalia Camacho-García-Formentí
+//  Rodrigo Zepeda-Tello
+//
+//----------------------------------------------------------------------------------------
+// License: MIT
+// Copyright 2018 Instituto Nacional de Salud Pública de México
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute,
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//----------------------------------------------------------------------------------------
+
+#ifndef window_sink_h
+#define window_sink_h
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+//Sink of the engine: the model gives noutputs outputs of individual i with
+//  static const int noutputs;
+//  void outputs(int i, double t, const double* y, int j, int n, double* v) const;
+//--------------------------------------------------------------------------------
+template <class Model>
+class WindowSink {
+public:
+
+    WindowSink(const Model& input_model, std::vector<double*> input_out,
+               std::vector<int> input_steps, int input_width) : model(input_model) {
+        if (input_out.size() > (size_t) Model::noutputs){
+            throw std::invalid_argument("Invalid outputs of model.");
+        }
+        out   = input_out;
+        steps = input_steps;
+        width = std::max(0, input_width);
+        nind  = 0;
+    }
+
+    void begin(int nsteps, int input_nind, int nstates){
+
+        nind = input_nind;
+        for (size_t k = 0; k < out.size(); k++){
+            std::fill(out[k], out[k] + ((size_t) nind)*steps.size(), 0.0);
+        }
+
+        //Output days (and weights) of each step by step (as CSR)
+        std::vector<int> count(nsteps + 2, 0);
+        for (size_t d = 0; d < steps.size(); d++){
+            for (int s = windowStart(d); s <= steps[d] && s <= nsteps; s++) count[s + 1]++;
+        }
+        for (int s = 0; s <= nsteps; s++) count[s + 1] += count[s];
+        start = count;
+        day.resize(count[nsteps + 1]);
+        weight.resize(count[nsteps + 1]);
+        for (size_t d = 0; d < steps.size(); d++){
+            int    a = windowStart(d);
+            int    b = steps[d];
+            double h = (b > a) ? 1.0/(b - a) : 1.0;
+            for (int s = a; s <= b && s <= nsteps; s++){
+                day[count[s]]      = d;
+                weight[count[s]++] = (b > a && (s == a || s == b)) ? 0.5*h : h;
+            }
+        }
+    }
+
+    //Blocks write into disjoint rows of the same matrices
+    WindowSink fork(void){
+        return *this;
+    }
+
+    void write(int step, double t, const double* y, int first, int n){
+        if (start[step] == start[step + 1]) return;
+        double v[Model::noutputs];
+        for (int j = 0; j < n; j++){
+            model.outputs(first + j, t, y, j, n, v);
+            for (int e = start[step]; e < start[step + 1]; e++){
+                size_t index = ((size_t) day[e])*nind + first + j;
+                for (size_t k = 0; k < out.size(); k++){
+                    out[k][index] += weight[e]*v[k];
+                }
+            }
+        }
+    }
+
+    void join(const WindowSink& local){}
+    void end(void){}
+
+private:
+
+    //First step of window of output day d
+    inline int windowStart(size_t d) const {
+        return std::max(0, steps[d] - width);
+    }
+
+    const Model&         model;
+    std::vector<double*> out;
+    std::vector<int>     steps;
+    std::vector<int>     start;  //Entries of step s are start[s], ..., start[s + 1] - 1
+    std::vector<int>     day;    //Output day of entry
+    std::vector<double>  weight; //Weight of step in mean of output day
+    int                  width;
+    int                  nind;
+};
+
+#endif /* window_sink_h */